@@ -0,0 +1,217 @@
+import argparse
+import contextlib
+import io
+import itertools
+import os
+import re
+import subprocess
+import zlib
+from collections import defaultdict
+from multiprocessing import Pool
+from pathlib import Path
+from KunitGeneration.data_ingestion.function_extraction import CFunctionExtractor
+from KunitGeneration.data_ingestion.git_source import GitObjectReader
+
+KUNIT_FILE_NAME = re.compile(r"(_kunit|_test|-test|_kunit_test|-kunit)\.c$")
+TOKEN = re.compile(r"[A-Za-z_]\w*|\d+|\S")
+
+# MinHash / LSH parameters: 128 hashes in 16 bands of 8 rows puts the LSH
+# candidate threshold near 0.7 Jaccard; candidates are then checked against JACCARD_DUP.
+NUM_HASHES = 128
+BANDS = 16
+ROWS = NUM_HASHES // BANDS
+SHINGLE = 5
+JACCARD_DUP = 0.8
+_PRIME = (1 << 61) - 1
+_SEEDS = [((i * 0x9E3779B1 + 1) % _PRIME, (i * 0x85EBCA77 + 7) % _PRIME) for i in range(NUM_HASHES)]
+
+
+def minhash_signature(text: str) -> tuple:
+    """MinHash over token shingles; identifiers are kept, numbers and literals normalized."""
+    tokens = ["N" if t.isdigit() else t for t in TOKEN.findall(text)]
+    shingles = {zlib.crc32(" ".join(tokens[i:i + SHINGLE]).encode())
+                for i in range(max(1, len(tokens) - SHINGLE + 1))}
+    return tuple(min((a * s + b) % _PRIME for s in shingles) for a, b in _SEEDS)
+
+
+def _chunk_file(args) -> list:
+    """Worker: split one KUnit file into function chunks with their MinHash signatures."""
+    kernel_dir, rel, source = args
+    if source is None:
+        try:
+            source = (Path(kernel_dir) / rel).read_text(encoding="utf-8", errors="ignore")
+        except OSError:
+            return []
+    if "kunit" not in source:
+        return []
+    extractor = CFunctionExtractor(source_code=source)
+    with contextlib.redirect_stdout(io.StringIO()):
+        extractor.extract_functions()
+    chunks = []
+    for func in extractor.functions:
+        code = func["code"]
+        if code.count("\n") < 3:
+            continue
+        chunks.append({
+            "id": f"{rel}::{func['name']}",
+            "text": f"// From {rel}\n{code}",
+            "signature": minhash_signature(code),
+        })
+    return chunks
+
+
+class NearDuplicateFilter:
+    """Streaming LSH over MinHash signatures; remembers every kept chunk."""
+
+    def __init__(self, threshold: float = JACCARD_DUP):
+        self.threshold = threshold
+        self.buckets = defaultdict(list)
+        self.signatures = []
+
+    def is_duplicate(self, signature: tuple) -> bool:
+        keys = [(band, signature[band * ROWS:(band + 1) * ROWS]) for band in range(BANDS)]
+        candidates = {idx for key in keys for idx in self.buckets.get(key, ())}
+        for idx in candidates:
+            other = self.signatures[idx]
+            if sum(a == b for a, b in zip(signature, other)) / NUM_HASHES >= self.threshold:
+                return True
+        idx = len(self.signatures)
+        self.signatures.append(signature)
+        for key in keys:
+            self.buckets[key].append(idx)
+        return False
+
+
+class KUnitCorpusIngestor:
+    """
+    Crawls a kernel checkout for existing KUnit tests, chunks them per function in parallel,
+    drops near-duplicates and streams the remaining chunks in batches to a sink.
+    With rev, files are read from the git objects of that commit instead of the worktree;
+    use the ingestor as a context manager so the git reader process is closed.
+    """
+
+    def __init__(self, kernel_dir: Path, workers: int = None, batch_size: int = 256, rev: str = None):
+        self.kernel_dir = Path(kernel_dir)
+        self.reader = GitObjectReader(self.kernel_dir, rev) if rev else None
+        self.workers = workers or os.cpu_count()
+        self.batch_size = batch_size
+        # Files handed to the pool at a time, so file texts are never all in memory at once
+        self.window = self.workers * 64
+        self.stats = {"files": 0, "chunks": 0, "duplicates": 0}
+
+    def close(self):
+        if self.reader is not None:
+            self.reader.close()
+            self.reader = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def find_test_files(self) -> list:
+        """`*_kunit.c`/`*_test.c` style names plus any file registering a suite."""
+        if self.reader is not None:
+            found = set(self.reader.grep(r"kunit_test_suites?\("))
+            found.update(p for p in self.reader.ls_files(suffixes=(".c",)) if KUNIT_FILE_NAME.search(Path(p).name))
+            return sorted(found)
+        found = set()
+        try:
+            out = subprocess.run(["git", "grep", "-l", "-E", r"kunit_test_suites?\(", "--", "*.c"],
+                                 cwd=self.kernel_dir, capture_output=True, text=True, check=True).stdout
+            found.update(out.split())
+        except (OSError, subprocess.CalledProcessError):
+            print("⚠️ git grep unavailable; falling back to file names only.")
+        for root, dirs, files in os.walk(self.kernel_dir):
+            dirs[:] = [d for d in dirs if not d.startswith(".")]
+            for name in files:
+                if KUNIT_FILE_NAME.search(name):
+                    found.add(os.path.relpath(os.path.join(root, name), self.kernel_dir))
+        return sorted(found)
+
+    def stream(self):
+        """Yield batches of unique chunks as [(chunk_id, text)]."""
+        files = self.find_test_files()
+        self.stats["files"] = len(files)
+        where = f"{self.kernel_dir} @ {self.reader.commit[:12]}" if self.reader else str(self.kernel_dir)
+        print(f"📚 Found {len(files)} KUnit test files under {where}")
+        dedup = NearDuplicateFilter()
+        batch = []
+        if self.reader is not None:
+            jobs = ((None, rel, text) for rel, text in self.reader.stream(files))
+        else:
+            jobs = ((str(self.kernel_dir), rel, None) for rel in files)
+        with Pool(self.workers) as pool:
+            # The pool's task feeder drains whatever iterable it gets, so feed it a window at a time
+            while True:
+                window = list(itertools.islice(jobs, self.window))
+                if not window:
+                    break
+                for chunks in pool.imap(_chunk_file, window, chunksize=16):
+                    for chunk in chunks:
+                        self.stats["chunks"] += 1
+                        if dedup.is_duplicate(chunk["signature"]):
+                            self.stats["duplicates"] += 1
+                            continue
+                        batch.append((chunk["id"], chunk["text"]))
+                        if len(batch) >= self.batch_size:
+                            yield batch
+                            batch = []
+        if batch:
+            yield batch
+
+    def ingest(self, out_dir: Path, embed_model=None, vector_store=None, extra_files: list = ()) -> list:
+        """
+        Write each unique chunk under out_dir (where the generator's index builders look)
+        and, if given, embed batch by batch and add each batch to the vector store as it comes.
+        extra_files (e.g. the hand-picked references) are indexed ahead of the corpus.
+        """
+        out_dir = Path(out_dir)
+        out_dir.mkdir(parents=True, exist_ok=True)
+        paths = [str(f) for f in extra_files]
+
+        def batches():
+            if paths:
+                yield [(f, Path(f).read_text(errors="ignore")) for f in paths]
+            for batch in self.stream():
+                written = []
+                for chunk_id, text in batch:
+                    path = out_dir / (re.sub(r"[^\w.-]+", "__", chunk_id) + ".c")
+                    path.write_text(text, encoding="utf-8")
+                    paths.append(str(path))
+                    written.append((str(path), text))
+                yield written
+
+        if vector_store is not None and embed_model is not None:
+            vector_store.build_streaming(
+                (embed_model.encode([text for _, text in batch]), [p for p, _ in batch])
+                for batch in batches() if batch)
+        else:
+            for _ in batches():
+                pass
+        kept = len(paths) - len(extra_files)
+        print(f"✅ Kept {kept} of {self.stats['chunks']} chunks ({self.stats['duplicates']} near-duplicates dropped)")
+        return paths
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Ingest existing kernel KUnit tests as a deduplicated reference corpus.")
+    parser.add_argument("kernel_dir")
+    parser.add_argument("--base-dir", default="main_test_dir")
+    parser.add_argument("--workers", type=int, default=None)
+    parser.add_argument("--index", action="store_true", help="embed chunks and rebuild the retrieval index")
+    parser.add_argument("--backend", default="faiss", choices=["faiss", "chroma"])
+    parser.add_argument("--rev", default=None, help="ingest this commit/tag from the git objects instead of the worktree")
+    args = parser.parse_args()
+
+    base_dir = Path(args.base_dir)
+    embed_model = store = None
+    if args.index:
+        from sentence_transformers import SentenceTransformer
+        from KunitGeneration.retrieval.vector_backends import make_backend
+        embed_model = SentenceTransformer("all-MiniLM-L6-v2")
+        store = make_backend(args.backend, base_dir)
+    with KUnitCorpusIngestor(Path(args.kernel_dir), workers=args.workers, rev=args.rev) as ingestor:
+        ingestor.ingest(base_dir / "reference_testcases" / "corpus", embed_model, store,
+                        extra_files=sorted((base_dir / "reference_testcases").glob("*.c")))
@@ -0,0 +1,190 @@
+import re
+from dataclasses import dataclass, field
+
+IDENTIFIER = re.compile(r"\b[A-Za-z_]\w*\b")
+STRINGS_AND_COMMENTS = re.compile(r'/\*.*?\*/|//[^\n]*|"(?:\\.|[^"\\])*"|\'(?:\\.|[^\'\\])*\'', re.DOTALL)
+TAG_DEFINITION = re.compile(r"^(?:typedef\s+)?(?:static\s+)?(?:const\s+)?(struct|union|enum)\s+(\w+)?\s*\{")
+C_KEYWORDS = {
+    "auto", "break", "case", "char", "const", "continue", "default", "do", "double", "else", "enum", "extern",
+    "float", "for", "goto", "if", "inline", "int", "long", "register", "return", "short", "signed", "sizeof",
+    "static", "struct", "switch", "typedef", "union", "unsigned", "void", "volatile", "while",
+}
+
+
+@dataclass
+class SourceItem:
+    """One top-level construct of the translation unit."""
+    kind: str            # include, macro, tag, typedef, prototype, function, global, other
+    text: str
+    start: int
+    names: set = field(default_factory=set)
+    refs: set = field(default_factory=set)
+
+    @property
+    def prototype(self) -> str:
+        """For function definitions: the signature as a declaration."""
+        return self.text[: self.text.index("{")].rstrip() + ";"
+
+
+class SourceDependencySlicer:
+    """
+    Cross-references the top-level items of a driver source so each function can be given
+    the minimal slice of includes, macros, types, globals and callee prototypes it depends on.
+    """
+
+    def __init__(self, source_code: str):
+        if not source_code:
+            raise ValueError("Source code cannot be empty.")
+        self.source_code = source_code
+        self.items = [self._classify(kind, start, end) for kind, start, end in self._split_top_level()]
+        self.definitions = {}
+        for item in self.items:
+            for name in item.names:
+                # A definition beats a forward declaration / prototype of the same name.
+                current = self.definitions.get(name)
+                if current is None or current.kind in ("prototype", "other"):
+                    self.definitions[name] = item
+
+    # ---------------- Parsing ----------------
+    def _split_top_level(self) -> list:
+        code, n = self.source_code, len(self.source_code)
+        items, i, start, depth = [], 0, None, 0
+        while i < n:
+            if code.startswith("/*", i):
+                i = code.find("*/", i + 2)
+                i = n if i < 0 else i + 2
+                continue
+            if code.startswith("//", i):
+                i = code.find("\n", i)
+                i = n if i < 0 else i
+                continue
+            c = code[i]
+            if start is None:
+                if c.isspace():
+                    i += 1
+                    continue
+                start = i
+                if c == "#":
+                    end = i
+                    while True:
+                        end = code.find("\n", end)
+                        if end < 0 or not code[:end].rstrip().endswith("\\"):
+                            break
+                        end += 1
+                    end = n if end < 0 else end
+                    items.append(("pp", start, end))
+                    start, i = None, end
+                    continue
+            if c in "\"'":
+                j = i + 1
+                while j < n and code[j] != c:
+                    j += 2 if code[j] == "\\" else 1
+                i = j + 1
+                continue
+            if c == "{":
+                depth += 1
+            elif c == "}":
+                depth -= 1
+                if depth == 0:
+                    header = code[start:code.index("{", start)]
+                    if re.search(r"\)\s*(?:__\w+(?:\([^)]*\))?\s*)*$", header) and "=" not in header:
+                        items.append(("function", start, i + 1))
+                        start = None
+            elif c == ";" and depth == 0:
+                items.append(("decl", start, i + 1))
+                start = None
+            i += 1
+        return items
+
+    def _classify(self, kind: str, start: int, end: int) -> SourceItem:
+        text = self.source_code[start:end]
+        bare = STRINGS_AND_COMMENTS.sub(" ", text)
+        item = SourceItem(kind="other", text=text, start=start)
+
+        if kind == "pp":
+            m = re.match(r"#\s*(include|define)\s+(\w+)?", bare)
+            if m and m.group(1) == "include":
+                item.kind = "include"
+            elif m and m.group(2):
+                item.kind = "macro"
+                item.names = {m.group(2)}
+                item.refs = set(IDENTIFIER.findall(bare[m.end():]))
+            return item
+
+        if kind == "function":
+            header = bare[: bare.index("{")]
+            name = re.search(r"(\w+)\s*\([^()]*(?:\([^()]*\)[^()]*)*\)\s*(?:__\w+(?:\([^)]*\))?\s*)*$", header)
+            item.kind = "function"
+            item.names = {name.group(1)} if name else set()
+            item.refs = set(IDENTIFIER.findall(bare)) - item.names
+            return item
+
+        item.refs = set(IDENTIFIER.findall(bare))
+        tag = TAG_DEFINITION.match(bare.strip())
+        if tag:
+            item.kind = "tag"
+            if tag.group(2):
+                item.names.add(f"{tag.group(1)} {tag.group(2)}")
+            body = bare[bare.index("{") + 1: bare.rindex("}")]
+            if tag.group(1) == "enum":
+                item.names |= {m.group(1) for m in re.finditer(r"(?:^|,)\s*(\w+)\s*(?==|,|$)", body)}
+            tail = re.search(r"\}\s*(\w+)\s*;\s*$", bare)
+            if tail and bare.lstrip().startswith("typedef"):
+                item.names.add(tail.group(1))
+            elif tail:
+                item.kind = "global"
+                item.names.add(tail.group(1))
+        elif bare.lstrip().startswith("typedef"):
+            item.kind = "typedef"
+            m = re.search(r"(\w+)\s*(?:\[[^\]]*\])?\s*;\s*$", bare) or re.search(r"\(\s*\*\s*(\w+)\s*\)", bare)
+            item.names = {m.group(1)} if m else set()
+        elif re.search(r"\w+\s*\([^=]*\)\s*;\s*$", bare) and "=" not in bare.split("(")[0]:
+            m = re.search(r"(\w+)\s*\(", bare)
+            words = IDENTIFIER.findall(bare.split("(")[0])
+            # `module_platform_driver(x);` style invocations have no return type before the name.
+            if m and len(words) > 1:
+                item.kind = "prototype"
+                item.names = {m.group(1)}
+        else:
+            m = re.search(r"(\w+)\s*(?:\[[^\]]*\]\s*)*(?:=|;)", bare)
+            if m:
+                item.kind = "global"
+                item.names = {m.group(1)}
+        item.refs -= item.names
+        return item
+
+    @staticmethod
+    def _ref_keys(refs: set, text: str) -> set:
+        """Identifiers plus `struct X` style tag references."""
+        keys = set(refs) - C_KEYWORDS
+        keys |= {f"{k} {n}" for k, n in re.findall(r"\b(struct|union|enum)\s+(\w+)", text)}
+        return keys
+
+    # ---------------- Slicing ----------------
+    def slice_for(self, function_name: str) -> str:
+        """Return the includes, definitions and callee prototypes function_name depends on, in source order."""
+        target = self.definitions.get(function_name)
+        if target is None or target.kind != "function":
+            return ""
+        chosen = {}
+        pending = list(self._ref_keys(target.refs, STRINGS_AND_COMMENTS.sub(" ", target.text)))
+        seen = set()
+        while pending:
+            key = pending.pop()
+            if key in seen:
+                continue
+            seen.add(key)
+            item = self.definitions.get(key)
+            if item is None or item is target:
+                continue
+            if item.kind == "function":
+                # Callees contribute only their prototype and the types in it.
+                signature = STRINGS_AND_COMMENTS.sub(" ", item.prototype)
+                chosen[item.start] = item.prototype
+                pending += self._ref_keys(set(IDENTIFIER.findall(signature)) - item.names, signature)
+            else:
+                chosen[item.start] = item.text
+                pending += self._ref_keys(item.refs, STRINGS_AND_COMMENTS.sub(" ", item.text))
+
+        includes = [i.text for i in self.items if i.kind == "include"]
+        return "\n".join(includes + [chosen[k] for k in sorted(chosen)])
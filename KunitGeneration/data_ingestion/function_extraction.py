@@ -112,7 +112,7 @@ class CFunctionExtractor(BaseFunctionExtractor):
             try:
                 end_index = self._find_matching_brace(start_index)
                 snippet = self.source_code[start_index:end_index]
-                self.functions.append({'name': func_name, 'code': snippet})
+                self.functions.append({'name': func_name, 'code': snippet, 'start': start_index, 'end': end_index})
             except ValueError as e:
                 print(f"Warning: Could not parse C function '{func_name}'. Reason: {e}")
 
@@ -162,7 +162,7 @@ class CppFunctionExtractor(BaseFunctionExtractor):
             try:
                 end_index = self._find_matching_brace(start_index)
                 snippet = self.source_code[start_index:end_index]
-                self.functions.append({'name': func_name, 'code': snippet})
+                self.functions.append({'name': func_name, 'code': snippet, 'start': start_index, 'end': end_index})
             except ValueError as e:
                 print(f"Warning: Could not parse C++ function '{func_name}'. Reason: {e}")
 
@@ -0,0 +1,140 @@
+import argparse
+import contextlib
+import io
+import subprocess
+import threading
+from pathlib import Path
+from KunitGeneration.data_ingestion.function_extraction import CFunctionExtractor
+
+
+class GitObjectReader:
+    """
+    Reads files of a local kernel git repository at a pinned commit straight from the object
+    database through one long-lived `git cat-file --batch` process, so whole subsystems can be
+    ingested at an exact revision without a checkout, a worktree or any network access.
+    """
+
+    def __init__(self, repo_dir: Path, rev: str = "HEAD"):
+        self.repo_dir = Path(repo_dir)
+        self.rev = rev
+        self.commit = self._git("rev-parse", "--verify", f"{rev}^{{commit}}").strip()
+        self._proc = None
+        self._lock = threading.Lock()
+
+    def _git(self, *args) -> str:
+        proc = subprocess.run(["git", *args], cwd=self.repo_dir, capture_output=True, text=True)
+        if proc.returncode != 0:
+            raise RuntimeError(f"git {' '.join(args)} failed: {proc.stderr.strip()}")
+        return proc.stdout
+
+    def _batch(self):
+        if self._proc is None or self._proc.poll() is not None:
+            self._proc = subprocess.Popen(["git", "cat-file", "--batch"], cwd=self.repo_dir,
+                                          stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+        return self._proc
+
+    @staticmethod
+    def _read_object(out):
+        """One `<oid> <type> <size>\\n<content>\\n` response; None for `<name> missing`."""
+        header = out.readline()
+        if not header:
+            raise RuntimeError("git cat-file --batch exited unexpectedly")
+        fields = header.split()
+        if len(fields) != 3:
+            return None         # missing / ambiguous
+        data = out.read(int(fields[2]))
+        out.read(1)
+        return data
+
+    # ---------------- Listing ----------------
+    def ls_files(self, paths: list = (), suffixes: tuple = (".c", ".h")) -> list:
+        """Repository-relative file paths under paths at the pinned commit."""
+        out = self._git("ls-tree", "-r", "--name-only", "-z", self.commit, "--", *paths)
+        return [p for p in out.split("\0") if p and (not suffixes or p.endswith(suffixes))]
+
+    def grep(self, pattern: str, pathspec: list = ("*.c",)) -> list:
+        """Files at the pinned commit whose content matches the extended regex pattern."""
+        proc = subprocess.run(["git", "grep", "-l", "-E", pattern, self.commit, "--", *pathspec],
+                              cwd=self.repo_dir, capture_output=True, text=True)
+        prefix = f"{self.commit}:"
+        return sorted(line.removeprefix(prefix) for line in proc.stdout.splitlines())
+
+    # ---------------- Reading ----------------
+    def read(self, path: str) -> str:
+        with self._lock:
+            proc = self._batch()
+            proc.stdin.write(f"{self.commit}:{path}\n".encode())
+            proc.stdin.flush()
+            data = self._read_object(proc.stdout)
+        if data is None:
+            raise FileNotFoundError(f"{path} does not exist at {self.rev} ({self.commit[:12]})")
+        return data.decode("utf-8", errors="ignore")
+
+    def stream(self, paths: list):
+        """
+        Yield (path, text) for every path in order, skipping missing ones. Requests are written
+        by a feeder thread while responses are read, so the pipe never stalls on large batches.
+        """
+        paths = list(paths)
+        with self._lock:
+            proc = self._batch()
+
+            def feed():
+                for p in paths:
+                    proc.stdin.write(f"{self.commit}:{p}\n".encode())
+                proc.stdin.flush()
+
+            feeder = threading.Thread(target=feed, daemon=True)
+            feeder.start()
+            pending = len(paths)
+            try:
+                for p in paths:
+                    data = self._read_object(proc.stdout)
+                    pending -= 1
+                    if data is not None:
+                        yield p, data.decode("utf-8", errors="ignore")
+            finally:
+                # A consumer that stops early must not leave responses in the pipe
+                for _ in range(pending):
+                    self._read_object(proc.stdout)
+                feeder.join()
+
+    def close(self):
+        if self._proc is not None:
+            self._proc.stdin.close()
+            self._proc.wait()
+            self._proc = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+
+def extract_subsystem(reader: GitObjectReader, paths: list, output_dir: Path) -> dict:
+    """Extract the functions of every .c file under paths into output_dir/<file stem>/."""
+    counts = {}
+    for rel, source in reader.stream(reader.ls_files(paths, suffixes=(".c",))):
+        if not source.strip():
+            continue
+        extractor = CFunctionExtractor(source_code=source)
+        with contextlib.redirect_stdout(io.StringIO()):
+            extractor.extract_functions()
+            extractor.save_to_files(str(Path(output_dir) / Path(rel).stem))
+        counts[rel] = len(extractor.functions)
+    return counts
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Extract functions from a kernel subsystem at a pinned git revision.")
+    parser.add_argument("repo_dir", help="local kernel git repository")
+    parser.add_argument("rev", help="commit, tag or branch, e.g. v6.10")
+    parser.add_argument("paths", nargs="+", help="files or directories, e.g. drivers/gpio")
+    parser.add_argument("-o", "--output", default="main_test_dir/test_functions")
+    args = parser.parse_args()
+
+    with GitObjectReader(Path(args.repo_dir), args.rev) as reader:
+        print(f"📌 {args.rev} -> {reader.commit[:12]}")
+        counts = extract_subsystem(reader, args.paths, Path(args.output))
+    print(f"✅ Extracted {sum(counts.values())} functions from {len(counts)} files into {args.output}")
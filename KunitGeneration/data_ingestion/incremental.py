@@ -0,0 +1,130 @@
+import argparse
+import bisect
+import contextlib
+import io
+import re
+import subprocess
+from dataclasses import dataclass, field
+from pathlib import Path
+from KunitGeneration.data_ingestion.function_extraction import CFunctionExtractor
+from KunitGeneration.data_ingestion.dependency_slicer import SourceDependencySlicer
+from KunitGeneration.data_ingestion.git_source import GitObjectReader
+
+HUNK = re.compile(r"^@@ -(\d+)(?:,(\d+))? \+(\d+)(?:,(\d+))? @@", re.MULTILINE)
+
+
+@dataclass
+class IncrementalPlan:
+    """Functions to (re)generate tests for after a driver changed between two commits."""
+    old_commit: str
+    new_commit: str
+    changed: set = field(default_factory=set)      # bodies touched by the diff (incl. new functions)
+    callers: set = field(default_factory=set)      # reached through the intra-file call graph
+    referenced: set = field(default_factory=set)   # existing tests that call a changed function
+    removed: set = field(default_factory=set)      # gone at the new commit; their tests are stale
+
+    @property
+    def queue(self) -> set:
+        return (self.changed | self.callers | self.referenced) - self.removed
+
+
+def diff_hunks(repo_dir: Path, old: str, new: str, path: str) -> list:
+    """(old_start, old_count, new_start, new_count) line ranges of a zero-context diff."""
+    out = subprocess.run(["git", "diff", "-U0", "--no-color", old, new, "--", path], cwd=repo_dir,
+                         capture_output=True, text=True, check=True).stdout
+    return [(int(a), int(b or 1), int(c), int(d or 1)) for a, b, c, d in HUNK.findall(out)]
+
+
+def function_lines(source: str) -> dict:
+    """{function name: (first line, last line)} of every definition the extractor finds."""
+    extractor = CFunctionExtractor(source_code=source)
+    with contextlib.redirect_stdout(io.StringIO()):
+        extractor.extract_functions()
+    starts = [0] + [i + 1 for i, c in enumerate(source) if c == "\n"]
+    spans = {}
+    for func in extractor.functions:
+        # The prototype match may begin on preceding blank lines
+        start = func["start"] + len(func["code"]) - len(func["code"].lstrip())
+        spans[func["name"]] = (bisect.bisect_right(starts, start), bisect.bisect_right(starts, func["end"] - 1))
+    return spans
+
+
+def touched(spans: dict, ranges: list) -> set:
+    """Functions whose line span overlaps any (start, count) range; pure insertions/deletions
+    (count 0) sit between lines and touch the function enclosing that point."""
+    hit = set()
+    for start, count in ranges:
+        lo, hi = (start, start + count - 1) if count else (start, start + 1)
+        for name, (first, last) in spans.items():
+            if first <= hi and lo <= last:
+                hit.add(name)
+    return hit
+
+
+def callers_of(source: str, functions: set, depth: int = 1) -> set:
+    """Functions of the same file that call into functions, up to depth levels up."""
+    slicer = SourceDependencySlicer(source)
+    defined = {n: item for n, item in slicer.definitions.items() if item.kind == "function"}
+    found, frontier = set(), set(functions)
+    for _ in range(depth):
+        frontier = {name for name, item in defined.items() if item.refs & frontier} - found - functions
+        if not frontier:
+            break
+        found |= frontier
+    return found
+
+
+def tests_referencing(output_dir: Path, functions: set) -> set:
+    """Functions whose existing generated test calls any of functions."""
+    if not functions:
+        return set()
+    call = re.compile(r"\b(" + "|".join(map(re.escape, sorted(functions))) + r")\s*\(")
+    owners = set()
+    for test in Path(output_dir).glob("*_kunit_test.c"):
+        if call.search(test.read_text(encoding="utf-8", errors="ignore")):
+            owners.add(test.name.removesuffix("_kunit_test.c"))
+    return owners
+
+
+def plan_incremental(repo_dir: Path, old: str, new: str, path: str, output_dir: Path = None,
+                     caller_depth: int = 1) -> IncrementalPlan:
+    """Map the diff of path between two commits onto its functions and what depends on them."""
+    with GitObjectReader(repo_dir, old) as old_reader, GitObjectReader(repo_dir, new) as new_reader:
+        try:
+            old_source = old_reader.read(path)
+        except FileNotFoundError:
+            old_source = ""
+        new_source = new_reader.read(path)
+        plan = IncrementalPlan(old_reader.commit, new_reader.commit)
+
+    hunks = diff_hunks(repo_dir, plan.old_commit, plan.new_commit, path)
+    new_spans = function_lines(new_source)
+    old_spans = function_lines(old_source) if old_source.strip() else {}
+    plan.changed = touched(new_spans, [(c, d) for _, _, c, d in hunks])
+    # Deleted lines only show up on the old side
+    plan.changed |= touched(old_spans, [(a, b) for a, b, _, _ in hunks]) & new_spans.keys()
+    plan.changed |= new_spans.keys() - old_spans.keys()
+    plan.removed = old_spans.keys() - new_spans.keys()
+    if plan.changed:
+        plan.callers = callers_of(new_source, plan.changed, caller_depth)
+    if output_dir is not None:
+        plan.referenced = tests_referencing(output_dir, plan.changed | plan.removed) & new_spans.keys()
+    return plan
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="List the functions of a driver affected between two commits.")
+    parser.add_argument("repo_dir")
+    parser.add_argument("old")
+    parser.add_argument("new")
+    parser.add_argument("path", help="driver source relative to the repository, e.g. drivers/gpio/gpio-amdpt.c")
+    parser.add_argument("--tests", default="main_test_dir/generated_tests")
+    parser.add_argument("--caller-depth", type=int, default=1)
+    args = parser.parse_args()
+
+    plan = plan_incremental(Path(args.repo_dir), args.old, args.new, args.path, Path(args.tests), args.caller_depth)
+    print(f"📌 {args.old} ({plan.old_commit[:12]}) -> {args.new} ({plan.new_commit[:12]})")
+    for label, names in (("changed", plan.changed), ("callers", plan.callers),
+                         ("referenced by tests", plan.referenced), ("removed", plan.removed)):
+        print(f"  {label}: {', '.join(sorted(names)) or '-'}")
+    print(f"✅ {len(plan.queue)} functions to regenerate")
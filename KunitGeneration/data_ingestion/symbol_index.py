@@ -0,0 +1,210 @@
+import mmap
+import os
+import re
+import struct
+import subprocess
+from concurrent.futures import ProcessPoolExecutor
+from pathlib import Path
+
+# ---------------- On-disk format ----------------
+# header  : magic, record count, header count, records offset, headers offset
+# records : sorted by symbol -> (symbol offset, header index, symbol length, kind)
+# headers : (path offset, path length)
+# strings : UTF-8 blob the offsets point into
+MAGIC = b"KSYMIDX1"
+FILE_HEADER = struct.Struct("<8sIIII")
+RECORD = struct.Struct("<IIHBx")
+HEADER_ENTRY = struct.Struct("<IHxx")
+
+KINDS = {"f": "function", "m": "macro", "s": "struct", "u": "union",
+         "e": "enum", "c": "enum constant", "t": "typedef"}
+
+# Include roots in preference order; a symbol declared in several places maps to the best one.
+INCLUDE_ROOTS = ["include", "arch/x86/include", "include/uapi", "arch/x86/include/uapi"]
+
+NOT_FUNCTIONS = {"if", "for", "while", "switch", "return", "sizeof", "typeof", "__attribute__",
+                 "defined", "asm", "__asm__", "alignof", "_Static_assert", "static_assert"}
+
+COMMENTS = re.compile(r"/\*.*?\*/|//[^\n]*", re.DOTALL)
+MACRO_DEF = re.compile(r"^[ \t]*#[ \t]*define[ \t]+(\w+)", re.MULTILINE)
+TAG_DEF = re.compile(r"\b(struct|union|enum)\s+(\w+)\s*\{")
+ENUM_BODY = re.compile(r"\benum\b[^{;]*\{([^}]*)\}")
+ENUM_CONST = re.compile(r"^\s*(\w+)\s*(?:=.*)?$")
+TYPEDEF = re.compile(r"^typedef\b[^;{]*?\b(\w+)\s*(?:\[[^\]]*\])?\s*;", re.MULTILINE)
+TYPEDEF_TAIL = re.compile(r"^\}\s*(\w+)\s*;", re.MULTILINE)
+FUNCTION = re.compile(r"^(?![ \t#]|typedef\b)[A-Za-z_][\w \t\*]*?\b(\w+)\s*\((?!\s*\*)[^;{)]*(?:\([^)]*\)[^;{)]*)*\)[\w \t\(\)]*\s*[;{]",
+                      re.MULTILINE)
+
+
+def _include_name(rel_path: str):
+    """Map a kernel-relative header path to the name used in #include <...>."""
+    for root in sorted(INCLUDE_ROOTS, key=len, reverse=True):
+        if rel_path.startswith(root + "/"):
+            return rel_path[len(root) + 1:], INCLUDE_ROOTS.index(root)
+    return None, len(INCLUDE_ROOTS)
+
+
+def _scan_headers(args) -> list:
+    """Worker: return (symbol, kind, rel_path) for every declaration in a chunk of headers."""
+    kernel_dir, rel_paths = args
+    found = []
+    for rel in rel_paths:
+        try:
+            text = (Path(kernel_dir) / rel).read_text(encoding="utf-8", errors="ignore")
+        except OSError:
+            continue
+        text = COMMENTS.sub("", text)
+        found += [(name, "m", rel) for name in MACRO_DEF.findall(text)]
+        found += [(name, tag[0], rel) for tag, name in TAG_DEF.findall(text)]
+        for body in ENUM_BODY.findall(text):
+            for item in body.split(","):
+                m = ENUM_CONST.match(item.strip())
+                if m:
+                    found.append((m.group(1), "c", rel))
+        found += [(name, "t", rel) for name in TYPEDEF.findall(text) + TYPEDEF_TAIL.findall(text)]
+        found += [(name, "f", rel) for name in FUNCTION.findall(text) if name not in NOT_FUNCTIONS]
+    return found
+
+
+class KernelSymbolIndexBuilder:
+    """Scans a kernel checkout's headers in parallel and writes a sorted, mmap-able symbol index."""
+
+    def __init__(self, kernel_dir: Path, index_path: Path, workers: int = None, chunk_size: int = 200):
+        self.kernel_dir = Path(kernel_dir)
+        self.index_path = Path(index_path)
+        self.workers = workers or os.cpu_count()
+        self.chunk_size = chunk_size
+
+    def _header_files(self) -> list:
+        files = []
+        for root in INCLUDE_ROOTS:
+            base = self.kernel_dir / root
+            if base.is_dir():
+                files += [str(p.relative_to(self.kernel_dir)) for p in base.rglob("*.h")]
+        return sorted(set(files))
+
+    @staticmethod
+    def _rank(kind: str, rel: str):
+        include_name, root_rank = _include_name(rel)
+        # Prefer linux/ headers, real declarations over macros, non-uapi roots and short paths.
+        return (0 if include_name and include_name.startswith("linux/") else 1, 0 if kind != "m" else 1,
+                root_rank, rel.count("/"), len(rel))
+
+    def build(self) -> Path:
+        files = self._header_files()
+        if not files:
+            raise FileNotFoundError(f"No headers found under {self.kernel_dir}/include")
+        print(f"📦 Scanning {len(files)} kernel headers with {self.workers} workers...")
+        chunks = [(str(self.kernel_dir), files[i:i + self.chunk_size]) for i in range(0, len(files), self.chunk_size)]
+
+        best = {}
+        with ProcessPoolExecutor(max_workers=self.workers) as pool:
+            for found in pool.map(_scan_headers, chunks):
+                for name, kind, rel in found:
+                    rank = self._rank(kind, rel)
+                    if name not in best or rank < best[name][0]:
+                        best[name] = (rank, kind, rel)
+
+        self._write(best)
+        print(f"✅ Indexed {len(best)} kernel symbols into {self.index_path}")
+        return self.index_path
+
+    def _write(self, best: dict):
+        headers = sorted({include_name for _, _, rel in best.values()
+                          for include_name in [_include_name(rel)[0] or rel]})
+        header_ids = {h: i for i, h in enumerate(headers)}
+        symbols = sorted(best)
+
+        blob = bytearray()
+        header_entries, records = [], []
+        for h in headers:
+            data = h.encode()
+            header_entries.append(HEADER_ENTRY.pack(len(blob), len(data)))
+            blob += data
+        for name in symbols:
+            _, kind, rel = best[name]
+            data = name.encode()
+            records.append((len(blob), header_ids[_include_name(rel)[0] or rel], len(data), ord(kind)))
+            blob += data
+
+        records_off = FILE_HEADER.size
+        headers_off = records_off + len(records) * RECORD.size
+        strings_off = headers_off + len(header_entries) * HEADER_ENTRY.size
+
+        self.index_path.parent.mkdir(parents=True, exist_ok=True)
+        tmp = self.index_path.with_suffix(".tmp")
+        with open(tmp, "wb") as f:
+            f.write(FILE_HEADER.pack(MAGIC, len(records), len(headers), records_off, headers_off))
+            for off, hid, length, kind in records:
+                f.write(RECORD.pack(strings_off + off, hid, length, kind))
+            for entry in header_entries:
+                off, length = HEADER_ENTRY.unpack(entry)
+                f.write(HEADER_ENTRY.pack(strings_off + off, length))
+            f.write(blob)
+        tmp.replace(self.index_path)
+
+
+class KernelSymbolIndex:
+    """Read-only, memory-mapped view of the symbol index; lookups are a binary search over the mapping."""
+
+    def __init__(self, index_path: Path):
+        self.index_path = Path(index_path)
+        self._file = open(self.index_path, "rb")
+        self._mm = mmap.mmap(self._file.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, self.count, self.header_count, self.records_off, self.headers_off = FILE_HEADER.unpack_from(self._mm, 0)
+        if magic != MAGIC:
+            raise ValueError(f"{self.index_path} is not a kernel symbol index")
+
+    @classmethod
+    def for_kernel(cls, kernel_dir: Path, cache_dir: Path, workers: int = None):
+        """Open the index for the kernel's current commit, building it on first use."""
+        kernel_dir = Path(kernel_dir)
+        try:
+            rev = subprocess.run(["git", "rev-parse", "HEAD"], cwd=kernel_dir, capture_output=True,
+                                 text=True, check=True).stdout.strip()[:12]
+        except (OSError, subprocess.CalledProcessError):
+            rev = "worktree"
+        index_path = Path(cache_dir) / f"kernel_symbols_{rev}.idx"
+        if not index_path.exists():
+            KernelSymbolIndexBuilder(kernel_dir, index_path, workers=workers).build()
+        return cls(index_path)
+
+    def _symbol_at(self, i: int):
+        off, hid, length, kind = RECORD.unpack_from(self._mm, self.records_off + i * RECORD.size)
+        return self._mm[off:off + length], hid, kind
+
+    def _header(self, hid: int) -> str:
+        off, length = HEADER_ENTRY.unpack_from(self._mm, self.headers_off + hid * HEADER_ENTRY.size)
+        return self._mm[off:off + length].decode()
+
+    def lookup(self, symbol: str):
+        """Return (header, kind) for symbol, or None."""
+        key = symbol.encode()
+        lo, hi = 0, self.count
+        while lo < hi:
+            mid = (lo + hi) // 2
+            name, hid, kind = self._symbol_at(mid)
+            if name < key:
+                lo = mid + 1
+            elif name > key:
+                hi = mid
+            else:
+                return self._header(hid), KINDS[chr(kind)]
+        return None
+
+    def header_for(self, symbol: str):
+        hit = self.lookup(symbol)
+        return hit[0] if hit else None
+
+    def headers_for_code(self, code: str) -> dict:
+        """Map every identifier in code that the index knows to its header."""
+        hints = {}
+        for ident in sorted(set(re.findall(r"\b[A-Za-z_]\w{2,}\b", code))):
+            header = self.header_for(ident)
+            if header:
+                hints[ident] = header
+        return hints
+
+    def close(self):
+        self._mm.close()
+        self._file.close()
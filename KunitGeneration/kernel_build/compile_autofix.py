@@ -0,0 +1,428 @@
+import json
+import re
+import sys
+from dataclasses import dataclass, field
+from pathlib import Path
+
+
+# ---------------- Diagnostics ----------------
+@dataclass(frozen=True)
+class FixIt:
+    """A compiler-suggested edit: replace [start, end) (1-based lines and byte columns) with text."""
+    file: str
+    line: int
+    column: int
+    end_line: int
+    end_column: int
+    text: str
+
+
+@dataclass
+class Diagnostic:
+    file: str
+    line: int
+    column: int
+    severity: str
+    message: str
+    notes: list = field(default_factory=list)
+    option: str = ""                                    # warning option, e.g. -Wunused-variable
+    fixits: list = field(default_factory=list)
+    include_chain: list = field(default_factory=list)   # (file, line) includers, innermost first
+
+    def in_file(self, name: str) -> bool:
+        return Path(self.file).name == name
+
+    def test_line(self, test_name: str, test_lines: list = None):
+        """
+        Line of the generated test this diagnostic belongs to: its own location, the include
+        that pulled in the header it points at, or a note inside the test; None otherwise.
+        """
+        if self.in_file(test_name):
+            return self.line
+        for file, line in self.include_chain:
+            if Path(file).name == test_name:
+                return line
+        if test_lines:
+            # JSON diagnostics carry no include chain; find the test's #include of the header
+            header = Path(self.file).as_posix()
+            for i, text in enumerate(test_lines, 1):
+                m = INCLUDE.match(text)
+                if m and header.endswith(m.group(1)):
+                    return i
+        for note in self.notes:
+            if note.in_file(test_name):
+                return note.line
+        return None
+
+
+GCC_LINE = re.compile(
+    r"^(?:ERROR:root:)?(?P<file>[^\s:][^:]*):(?P<line>\d+):(?:(?P<col>\d+):)?\s*"
+    r"(?P<severity>fatal error|error|warning|note):\s*(?P<message>.*?)(?:\s+\[(?P<option>-W[^\]]+)\])?$"
+)
+INCLUDED_FROM = re.compile(r"^(?:ERROR:root:)?(?:In file included )?from (?P<file>[^\s:][^:]*):(?P<line>\d+)[:,]?$")
+# "x.h: In function 'f':" sits between an include chain and the diagnostic it belongs to
+CONTEXT_LINE = re.compile(r"^(?:ERROR:root:)?[^\s:][^:]*: (?:In |At top level)")
+INCLUDE = re.compile(r'^\s*#\s*include\s*[<"]([^>"]+)[>"]')
+# -fdiagnostics-format=json writes one array per translation unit on a single stderr line
+JSON_DIAGNOSTICS = re.compile(r'^(?:ERROR:root:)?\s*(\[\{"kind".*\])\s*$')
+
+# Appended to KCFLAGS so GCC reports diagnostics as JSON instead of caret text
+JSON_DIAGNOSTICS_FLAG = "-fdiagnostics-format=json"
+
+
+def _clean_message(message: str) -> str:
+    # GCC uses typographic quotes in UTF-8 locales
+    return message.replace("‘", "'").replace("’", "'").strip()
+
+
+def _from_json(entry: dict) -> Diagnostic:
+    locations = entry.get("locations") or [{}]
+    caret = locations[0].get("caret", {})
+    diag = Diagnostic(
+        file=caret.get("file", ""),
+        line=int(caret.get("line", 0)),
+        column=int(caret.get("byte-column", caret.get("column", 0))),
+        severity=entry.get("kind", "error"),
+        message=_clean_message(entry.get("message", "")),
+        option=entry.get("option", ""),
+    )
+    for fix in entry.get("fixits", []):
+        start, end = fix["start"], fix["next"]
+        diag.fixits.append(FixIt(start["file"], start["line"], start.get("byte-column", start["column"]),
+                                 end["line"], end.get("byte-column", end["column"]), fix["string"]))
+    diag.notes = [_from_json(child) for child in entry.get("children", [])]
+    return diag
+
+
+def parse_gcc_diagnostics(log_text: str) -> list:
+    """
+    Parse a build log into Diagnostics. JSON diagnostic arrays are read as they are; GCC/kunit.py
+    text lines are matched, with notes attached to the preceding diagnostic and "In file
+    included from" lines recorded as its include chain.
+    """
+    diagnostics = []
+    chain = []
+    for raw in log_text.splitlines():
+        line = raw.strip()
+        m = JSON_DIAGNOSTICS.match(line)
+        if m:
+            try:
+                entries = json.loads(m.group(1))
+            except json.JSONDecodeError:
+                # Interleaved output of a parallel make; the text fallback still sees nothing here
+                continue
+            diagnostics.extend(_from_json(e) for e in entries if e.get("kind") != "note")
+            continue
+        m = INCLUDED_FROM.match(line)
+        if m:
+            chain.append((m.group("file"), int(m.group("line"))))
+            continue
+        m = GCC_LINE.match(line)
+        if not m:
+            # kunit.py logs put a blank line after every line; only other text ends an include chain
+            if line and not CONTEXT_LINE.match(line):
+                chain = []
+            continue
+        diag = Diagnostic(
+            file=m.group("file"),
+            line=int(m.group("line")),
+            column=int(m.group("col") or 0),
+            severity=m.group("severity"),
+            message=_clean_message(m.group("message")),
+            option=m.group("option") or "",
+            include_chain=chain,
+        )
+        chain = []
+        if diag.severity == "note":
+            if diagnostics:
+                diagnostics[-1].notes.append(diag)
+            continue
+        diagnostics.append(diag)
+    return diagnostics
+
+
+def is_diagnostic_line(line: str) -> bool:
+    """Whether parse_gcc_diagnostics accounts for this log line."""
+    line = line.strip()
+    return bool(JSON_DIAGNOSTICS.match(line) or GCC_LINE.match(line) or INCLUDED_FROM.match(line))
+
+
+def format_diagnostics(diagnostics: list, test_file: Path = None) -> list:
+    """
+    One block per unique error: location and message, the generated-test line it maps to and
+    any fix-it hints, in the caret style of GCC text output. Used for repair prompts.
+    """
+    test_name = Path(test_file).name if test_file else None
+    test_lines = []
+    if test_file and Path(test_file).exists():
+        test_lines = Path(test_file).read_text(encoding="utf-8", errors="ignore").splitlines()
+    seen, blocks = set(), []
+    for diag in diagnostics:
+        if diag.severity not in ("error", "fatal error"):
+            continue
+        key = (diag.file, diag.line, diag.message)
+        if key in seen:
+            continue
+        seen.add(key)
+        option = f" [{diag.option}]" if diag.option else ""
+        block = [f"{Path(diag.file).name}:{diag.line}:{diag.column}: {diag.severity}: {diag.message}{option}"]
+        line = diag.test_line(test_name, test_lines) if test_name else None
+        if line and 0 < line <= len(test_lines):
+            where = "" if diag.in_file(test_name) else f"  (from {test_name}:{line})"
+            block.append(f"{line:>5} | {test_lines[line - 1].rstrip()}{where}")
+        for fix in diag.fixits:
+            if fix.text and (fix.line, fix.column) == (fix.end_line, fix.end_column):
+                block.append(f"      fix-it: insert {fix.text.strip()!r} at {fix.line}:{fix.column}")
+            else:
+                block.append(f"      fix-it: replace {fix.line}:{fix.column}-{fix.end_line}:{fix.end_column} "
+                             f"with {fix.text!r}")
+        for note in diag.notes:
+            block.append(f"      note: {Path(note.file).name}:{note.line}: {note.message}")
+        blocks.append("\n".join(block))
+    return blocks
+
+
+# ---------------- Edits ----------------
+@dataclass(frozen=True)
+class Edit:
+    """Replace lines[start:end] (0-based) with replacement."""
+    start: int
+    end: int
+    replacement: tuple = ()
+    reason: str = ""
+
+
+def _define_span(lines: list, idx: int) -> int:
+    end = idx
+    while end < len(lines) and lines[end].rstrip().endswith("\\"):
+        end += 1
+    return end + 1
+
+
+def _block_span(lines: list, idx: int) -> int:
+    """End (exclusive) of the brace block that opens on or after lines[idx], including a trailing ';'."""
+    depth, opened = 0, False
+    for i in range(idx, len(lines)):
+        depth += lines[i].count("{") - lines[i].count("}")
+        opened = opened or "{" in lines[i]
+        if opened and depth <= 0:
+            return i + 1
+    return -1
+
+
+def _first_include_index(lines: list) -> int:
+    for i, line in enumerate(lines):
+        if line.lstrip().startswith("#include"):
+            return i
+    return 0
+
+
+# Headers for the symbols LLM-written tests most often use without including.
+KNOWN_HEADERS = {
+    "kunit_kzalloc": "kunit/test.h", "kunit_kmalloc": "kunit/test.h",
+    "readl": "linux/io.h", "writel": "linux/io.h", "ioremap": "linux/io.h",
+    "devm_kzalloc": "linux/device.h", "dev_get_drvdata": "linux/device.h", "device": "linux/device.h",
+    "platform_get_drvdata": "linux/platform_device.h", "platform_set_drvdata": "linux/platform_device.h",
+    "platform_device": "linux/platform_device.h", "devm_platform_ioremap_resource": "linux/platform_device.h",
+    "gpiochip_get_data": "linux/gpio/driver.h", "gpio_chip": "linux/gpio/driver.h", "bgpio_init": "linux/gpio/driver.h",
+    "raw_spin_lock_irqsave": "linux/spinlock.h", "spin_lock_irqsave": "linux/spinlock.h",
+    "kzalloc": "linux/slab.h", "kfree": "linux/slab.h", "GFP_KERNEL": "linux/gfp.h",
+    "memset": "linux/string.h", "memcpy": "linux/string.h", "BIT": "linux/bits.h",
+    "ENOMEM": "linux/errno.h", "ENODEV": "linux/errno.h", "EINVAL": "linux/errno.h",
+    "IS_ERR": "linux/err.h", "PTR_ERR": "linux/err.h", "ERR_PTR": "linux/err.h",
+    "ACPI_COMPANION": "linux/acpi.h", "pinctrl_dev": "linux/pinctrl/pinctrl.h",
+}
+
+
+# ---------------- Rules ----------------
+class FixRule:
+    """A diagnostic message pattern plus the mechanical edit that fixes it in the generated test."""
+    name = "rule"
+    pattern = None
+
+    def match(self, diag: Diagnostic):
+        return self.pattern.search(diag.message) if self.pattern else None
+
+    def fix(self, diag: Diagnostic, match, lines: list, test_name: str) -> list:
+        raise NotImplementedError("Subclasses must implement fix().")
+
+
+class RedefinedMacroRule(FixRule):
+    """`"dev_dbg" redefined`: the test's own #define loses to the kernel/driver one."""
+    name = "redefined-macro"
+    pattern = re.compile(r'"(\w+)" redefined')
+
+    def fix(self, diag, match, lines, test_name):
+        macro = match.group(1)
+        for loc in [diag] + diag.notes:
+            if loc.in_file(test_name) and 0 < loc.line <= len(lines):
+                idx = loc.line - 1
+                if re.match(rf"\s*#\s*define\s+{macro}\b", lines[idx]):
+                    return [Edit(idx, _define_span(lines, idx), (), f"drop duplicate #define {macro}")]
+        return []
+
+
+class RedefinitionRule(FixRule):
+    """`redefinition of 'struct X'` / `redefinition of 'func'`: the driver already provides it."""
+    name = "redefinition"
+    pattern = re.compile(r"redefinition of '(?:(struct|union|enum) )?(\w+)'")
+
+    def fix(self, diag, match, lines, test_name):
+        kind, name = match.group(1), match.group(2)
+        if kind:
+            opener = re.compile(rf"^\s*(?:typedef\s+)?{kind}\s+{name}\s*\{{?\s*$")
+        else:
+            opener = re.compile(rf"^[^;#]*\b{name}\s*\([^;]*$")
+        for loc in [diag] + diag.notes:
+            if not loc.in_file(test_name) or not 0 < loc.line <= len(lines):
+                continue
+            idx = loc.line - 1
+            if opener.match(lines[idx]):
+                end = _block_span(lines, idx)
+                if end > idx:
+                    return [Edit(idx, end, (), f"drop test copy of {kind + ' ' if kind else ''}{name}")]
+        return []
+
+
+class MissingIncludeRule(FixRule):
+    """Implicit declarations, unknown types and undeclared constants resolved through a header lookup."""
+    name = "missing-include"
+    pattern = re.compile(
+        r"implicit declaration of function '(\w+)'|unknown type name '(\w+)'|'(\w+)' undeclared"
+        r"|storage size of '\w+' isn't known|invalid use of undefined type 'struct (\w+)'"
+    )
+
+    def __init__(self, resolver=None):
+        # resolver(symbol) -> header path or None, e.g. KernelSymbolIndex.header_for;
+        # the built-in table covers the common symbols when no index is available
+        self.resolver = resolver
+
+    def _resolve(self, symbol: str):
+        return (self.resolver(symbol) if self.resolver else None) or KNOWN_HEADERS.get(symbol)
+
+    def fix(self, diag, match, lines, test_name):
+        if not diag.in_file(test_name):
+            return []
+        symbol = next((g for g in match.groups() if g), None)
+        header = self._resolve(symbol) if symbol else None
+        if not header:
+            return []
+        include = f"#include <{header}>"
+        if any(l.strip() == include for l in lines):
+            return []
+        idx = _first_include_index(lines)
+        return [Edit(idx, idx, (include,), f"add {include} for {symbol}")]
+
+
+class CompilerFixItRule(FixRule):
+    """Apply GCC's own fix-it hints ("did you mean", missing include...) when they are all in the test."""
+    name = "compiler-fixit"
+
+    def match(self, diag: Diagnostic):
+        return bool(diag.fixits) or None
+
+    def fix(self, diag, match, lines, test_name):
+        fixits = diag.fixits
+        if not all(Path(f.file).name == test_name and f.line == f.end_line and 0 < f.line <= len(lines)
+                   for f in fixits):
+            return []
+        edits = []
+        for line_no in sorted({f.line for f in fixits}):
+            text = lines[line_no - 1]
+            # Right to left so earlier columns stay valid
+            for f in sorted((f for f in fixits if f.line == line_no), key=lambda f: f.column, reverse=True):
+                text = text[:f.column - 1] + f.text + text[f.end_column - 1:]
+            edits.append(Edit(line_no - 1, line_no, tuple(text.split("\n")), f"compiler fix-it for '{diag.message[:60]}'"))
+        return edits
+
+
+class ConstMemberAssignmentRule(FixRule):
+    """`assignment of read-only member 'x'`: drop the single assignment statement."""
+    name = "const-member-assignment"
+    pattern = re.compile(r"assignment of read-only (?:member|location|variable) '?([^']*)'?")
+
+    def fix(self, diag, match, lines, test_name):
+        if not diag.in_file(test_name) or not 0 < diag.line <= len(lines):
+            return []
+        idx = diag.line - 1
+        stmt = lines[idx].strip()
+        if "=" not in stmt or not stmt.endswith(";") or "{" in stmt:
+            return []
+        indent = lines[idx][: len(lines[idx]) - len(lines[idx].lstrip())]
+        return [Edit(idx, idx + 1, (f"{indent}/* autofix: removed assignment to read-only {match.group(1)} */",),
+                     f"drop assignment to read-only {match.group(1)}")]
+
+
+# ---------------- Engine ----------------
+@dataclass
+class AutoFixResult:
+    code: str
+    applied: list
+    unresolved: list
+
+    @property
+    def changed(self) -> bool:
+        return bool(self.applied)
+
+
+class AutoFixEngine:
+    """
+    Runs pattern -> fix rules over parsed diagnostics and patches the generated test
+    directly. Errors no rule could handle are returned as unresolved for the LLM.
+    """
+
+    def __init__(self, rules: list = None, header_resolver=None):
+        self.rules = rules if rules is not None else [
+            RedefinedMacroRule(),
+            RedefinitionRule(),
+            MissingIncludeRule(header_resolver),
+            ConstMemberAssignmentRule(),
+            CompilerFixItRule(),
+        ]
+
+    def register(self, rule: FixRule, first: bool = False):
+        if first:
+            self.rules.insert(0, rule)
+        else:
+            self.rules.append(rule)
+
+    def run(self, test_file: Path, diagnostics: list) -> AutoFixResult:
+        test_name = Path(test_file).name
+        lines = Path(test_file).read_text(encoding="utf-8").splitlines()
+        edits, unresolved = {}, []
+        for diag in diagnostics:
+            handled = False
+            for rule in self.rules:
+                match = rule.match(diag)
+                if not match:
+                    continue
+                for edit in rule.fix(diag, match, lines, test_name):
+                    edits[(edit.start, edit.end, edit.replacement)] = edit
+                    handled = True
+                if handled:
+                    break
+            if not handled and diag.severity in ("error", "fatal error"):
+                unresolved.append(diag)
+
+        # Apply bottom-up so earlier line numbers stay valid; skip edits overlapping an applied one.
+        applied, floor = [], len(lines) + 1
+        for edit in sorted(edits.values(), key=lambda e: (e.start, e.end), reverse=True):
+            if edit.end > floor:
+                continue
+            lines[edit.start:edit.end] = list(edit.replacement)
+            floor = edit.start
+            applied.append(edit.reason)
+
+        return AutoFixResult(code="\n".join(lines) + "\n", applied=applied[::-1], unresolved=unresolved)
+
+
+if __name__ == "__main__":
+    # Self-check on a real kunit.py log: diagnostics parse and keep their include chains
+    log = Path(sys.argv[1] if len(sys.argv) > 1 else "main_test_dir/compilation_log/compile_error.txt")
+    diagnostics = parse_gcc_diagnostics(log.read_text(encoding="utf-8", errors="ignore"))
+    for diag in diagnostics:
+        chain = " <- ".join(f"{f}:{n}" for f, n in diag.include_chain)
+        print(f"{diag.file}:{diag.line} {diag.severity}: {diag.message}" + (f"\n    included from {chain}" if chain else ""))
+    assert diagnostics, f"no diagnostics parsed from {log}"
+    assert any(d.include_chain for d in diagnostics), f"no include chain parsed from {log}"
+    print(f"✅ {len(diagnostics)} diagnostics, {sum(bool(d.include_chain) for d in diagnostics)} with include chains")
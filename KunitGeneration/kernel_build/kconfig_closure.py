@@ -0,0 +1,385 @@
+import argparse
+import glob
+import re
+from dataclasses import dataclass, field
+from pathlib import Path
+
+# ---------------- Expressions ----------------
+# AST nodes: ("sym", name) | ("not", e) | ("and", a, b) | ("or", a, b) | ("cmp", op, left, right)
+EXPR_TOKEN = re.compile(r'\s*(&&|\|\||!=|<=|>=|[!()=<>]|"[^"]*"|[\w.$-]+)')
+
+
+def parse_expr(text: str):
+    tokens = EXPR_TOKEN.findall(text)
+    pos = 0
+
+    def peek():
+        return tokens[pos] if pos < len(tokens) else None
+
+    def take():
+        nonlocal pos
+        pos += 1
+        return tokens[pos - 1]
+
+    def primary():
+        tok = take()
+        if tok == "!":
+            return ("not", primary())
+        if tok == "(":
+            node = disjunction()
+            if peek() == ")":
+                take()
+            return node
+        left = ("sym", tok.strip('"'))
+        if peek() in ("=", "!=", "<", ">", "<=", ">="):
+            op = take()
+            return ("cmp", op, left, ("sym", take().strip('"')))
+        return left
+
+    def conjunction():
+        node = primary()
+        while peek() == "&&":
+            take()
+            node = ("and", node, primary())
+        return node
+
+    def disjunction():
+        node = conjunction()
+        while peek() == "||":
+            take()
+            node = ("or", node, conjunction())
+        return node
+
+    return disjunction() if tokens else None
+
+
+# ---------------- Kconfig model ----------------
+@dataclass
+class KconfigSymbol:
+    name: str
+    type: str = ""
+    prompt: bool = False
+    prompt_if: tuple = None
+    depends: list = field(default_factory=list)      # ANDed ASTs, including enclosing if/menu conditions
+    selects: list = field(default_factory=list)      # (symbol, condition AST or None)
+    defaults: list = field(default_factory=list)     # (value AST, condition AST or None)
+    defined_in: list = field(default_factory=list)
+
+
+class KconfigTree:
+    """
+    Line-oriented parser for Kconfig files: config/menuconfig entries with their type,
+    prompt, depends on, select and default attributes, following source/rsource and
+    carrying if/menu/choice conditions down to the entries inside them.
+    """
+
+    ENTRY = re.compile(r"^(menuconfig|config)\s+(\w+)")
+    SOURCE = re.compile(r'^(source|rsource|osource|orsource)\s+"([^"]+)"')
+    TYPE = re.compile(r'^(bool|tristate|int|hex|string)(?:\s+"[^"]*"(?:\s+if\s+(.*))?)?\s*$')
+    DEF_TYPE = re.compile(r"^def_(bool|tristate)\s+(.+?)(?:\s+if\s+(.*))?$")
+    PROMPT = re.compile(r'^prompt\s+"[^"]*"(?:\s+if\s+(.*))?$')
+    SELECT = re.compile(r"^(?:select|imply)\s+(\w+)(?:\s+if\s+(.*))?$")
+    DEFAULT = re.compile(r"^default\s+(.+?)(?:\s+if\s+(.*))?$")
+
+    def __init__(self, root_kconfig: Path, srctree: Path = None, srcarch: str = "x86"):
+        self.root = Path(root_kconfig)
+        self.srctree = Path(srctree) if srctree else self.root.parent
+        self.srcarch = srcarch
+        self.symbols = {}
+        self.files = []
+        self._parse_file(self.root, [])
+
+    def _resolve_sources(self, kind: str, pattern: str, current: Path) -> list:
+        pattern = pattern.replace("$(SRCARCH)", self.srcarch).replace("$SRCARCH", self.srcarch)
+        if "$" in pattern:
+            return []
+        base = current.parent if kind.startswith(("r", "or")) else self.srctree
+        matches = sorted(glob.glob(str(base / pattern)))
+        if not matches and kind in ("source", "rsource") and (current.parent / pattern).exists():
+            # Standalone copies of a subsystem Kconfig keep their sibling files next to them
+            matches = [str(current.parent / pattern)]
+        return [Path(m) for m in matches]
+
+    @staticmethod
+    def _logical_lines(text: str):
+        """(indent, stripped line) with backslash continuations joined and help text skipped."""
+        lines = text.expandtabs(8).splitlines()
+        i = 0
+        while i < len(lines):
+            line = lines[i]
+            while line.rstrip().endswith("\\") and i + 1 < len(lines):
+                i += 1
+                line = line.rstrip()[:-1] + " " + lines[i].strip()
+            i += 1
+            stripped = line.split("#", 1)[0].strip() if not line.lstrip().startswith(("help", "---help---")) else line.strip()
+            if not stripped:
+                continue
+            indent = len(line) - len(line.lstrip())
+            if stripped in ("help", "---help---"):
+                # Help text runs until a line indented no deeper than the help keyword
+                while i < len(lines) and (not lines[i].strip() or len(lines[i]) - len(lines[i].lstrip()) > indent):
+                    i += 1
+                continue
+            yield indent, stripped
+
+    def _parse_file(self, path: Path, inherited: list):
+        try:
+            text = path.read_text(encoding="utf-8", errors="ignore")
+        except OSError:
+            return
+        self.files.append(path)
+        # Block stack: ("if"|"menu"|"choice", [conditions]); entry is the symbol receiving attributes
+        stack = [("file", list(inherited))]
+        entry, block_attrs = None, None
+
+        def context_conds():
+            return [c for _, conds in stack for c in conds]
+
+        for _, line in self._logical_lines(text):
+            keyword = line.split()[0]
+            m = self.ENTRY.match(line)
+            if m:
+                entry = self.symbols.setdefault(m.group(2), KconfigSymbol(m.group(2)))
+                entry.defined_in.append(str(path))
+                entry.depends.extend(context_conds())
+                block_attrs = None
+                continue
+            m = self.SOURCE.match(line)
+            if m:
+                for src in self._resolve_sources(m.group(1), m.group(2), path):
+                    self._parse_file(src, context_conds())
+                entry = block_attrs = None
+                continue
+            if keyword == "if":
+                stack.append(("if", [parse_expr(line[2:])]))
+                entry = block_attrs = None
+                continue
+            if keyword in ("menu", "choice"):
+                stack.append((keyword, []))
+                entry, block_attrs = None, stack[-1][1]
+                continue
+            if keyword in ("endif", "endmenu", "endchoice"):
+                if len(stack) > 1:
+                    stack.pop()
+                entry = block_attrs = None
+                continue
+            if keyword in ("comment", "mainmenu"):
+                entry, block_attrs = None, []
+                continue
+
+            if line.startswith("depends on"):
+                cond = parse_expr(line[len("depends on"):])
+                if entry is not None:
+                    entry.depends.append(cond)
+                elif block_attrs is not None:
+                    block_attrs.append(cond)
+                continue
+            if entry is None:
+                continue
+            m = self.TYPE.match(line)
+            if m:
+                entry.type = m.group(1)
+                if '"' in line:
+                    entry.prompt = True
+                    entry.prompt_if = parse_expr(m.group(2)) if m.group(2) else None
+                continue
+            m = self.DEF_TYPE.match(line)
+            if m:
+                entry.type = m.group(1)
+                entry.defaults.append((parse_expr(m.group(2)), parse_expr(m.group(3)) if m.group(3) else None))
+                continue
+            m = self.PROMPT.match(line)
+            if m:
+                entry.prompt = True
+                entry.prompt_if = parse_expr(m.group(1)) if m.group(1) else None
+                continue
+            m = self.SELECT.match(line)
+            if m and line.startswith("select"):
+                entry.selects.append((m.group(1), parse_expr(m.group(2)) if m.group(2) else None))
+                continue
+            m = self.DEFAULT.match(line)
+            if m:
+                entry.defaults.append((parse_expr(m.group(1)), parse_expr(m.group(2)) if m.group(2) else None))
+
+
+# ---------------- Makefile lookup ----------------
+OBJ_LINE = re.compile(r"^(obj|[\w-]+)-(?:\$\(CONFIG_(\w+)\)|y|objs)\s*[+:]?=\s*(.*)$")
+
+
+def config_for_object(makefile: Path, object_name: str):
+    """The CONFIG_ symbol (without prefix) that builds object_name, following `foo-y += bar.o` composites."""
+    text = Path(makefile).read_text(encoding="utf-8", errors="ignore").replace("\\\n", " ")
+    owners, composites = {}, {}
+    for line in text.splitlines():
+        m = OBJ_LINE.match(line.strip())
+        if not m:
+            continue
+        target, config, objs = m.groups()
+        for obj in objs.split():
+            if target == "obj" and config:
+                owners.setdefault(obj, config)
+            elif target != "obj":
+                composites.setdefault(obj, f"{target}.o")
+    name = object_name if object_name.endswith(".o") else f"{object_name}.o"
+    seen = set()
+    while name not in owners and name in composites and name not in seen:
+        seen.add(name)
+        name = composites[name]
+    return owners.get(name)
+
+
+# ---------------- Closure ----------------
+class KconfigClosure:
+    """
+    Smallest set of symbols to write into a kunitconfig so the targets are enabled.
+    Dependencies are satisfied recursively; for `A || B` the alternative with the lower
+    estimated cost wins (ties go to the one written first). Symbols that a `select`
+    forces on, or that default to y once their dependencies hold, are left for
+    olddefconfig and not written. Symbols outside the parsed files are listed explicitly
+    unless assumed to come from the architecture's defaults.
+    """
+
+    # Options that pull in far more than they satisfy
+    PENALTY = {"COMPILE_TEST": 8, "EXPERT": 4}
+
+    def __init__(self, tree: KconfigTree, assume: set = ()):
+        self.tree = tree
+        self.on = set(assume)
+        self.order = []
+        self.selected = set()
+        self.unsatisfiable = []
+
+    # ---------------- Evaluation ----------------
+    def _eval(self, node) -> bool:
+        if node is None:
+            return True
+        kind = node[0]
+        if kind == "sym":
+            return node[1] in ("y", "m") or node[1] in self.on
+        if kind == "not":
+            return not self._eval(node[1])
+        if kind == "and":
+            return self._eval(node[1]) and self._eval(node[2])
+        if kind == "or":
+            return self._eval(node[1]) or self._eval(node[2])
+        op, (_, left), (_, right) = node[1], node[2], node[3]
+        if right in ("y", "m", "n") and op in ("=", "!="):
+            return (left in self.on) == ((right != "n") == (op == "="))
+        return True
+
+    def _defaults_on(self, sym: KconfigSymbol) -> bool:
+        return any(self._eval(value) and (cond is None or self._eval(cond))
+                   for value, cond in sym.defaults if value and value[0] == "sym" and value[1] != "n")
+
+    def _cost(self, node, seen: frozenset) -> int:
+        if node is None or self._eval(node):
+            return 0
+        kind = node[0]
+        if kind == "sym":
+            return self._symbol_cost(node[1], seen)
+        if kind == "and":
+            return self._cost(node[1], seen) + self._cost(node[2], seen)
+        if kind == "or":
+            return min(self._cost(node[1], seen), self._cost(node[2], seen))
+        if kind == "cmp" and node[3][1] != "n" and node[1] == "=":
+            return self._symbol_cost(node[2][1], seen)
+        return 0
+
+    def _symbol_cost(self, name: str, seen: frozenset) -> int:
+        if name in self.on or name in seen:
+            return 0
+        penalty = self.PENALTY.get(name, 0)
+        sym = self.tree.symbols.get(name)
+        if sym is None:
+            return 1 + penalty
+        seen = seen | {name}
+        return 1 + penalty + sum(self._cost(d, seen) for d in sym.depends)
+
+    # ---------------- Enabling ----------------
+    def _satisfy(self, node):
+        if node is None or self._eval(node):
+            return
+        kind = node[0]
+        if kind == "sym":
+            self.enable(node[1])
+        elif kind == "and":
+            self._satisfy(node[1])
+            self._satisfy(node[2])
+        elif kind == "or":
+            left, right = self._cost(node[1], frozenset()), self._cost(node[2], frozenset())
+            self._satisfy(node[1] if left <= right else node[2])
+        elif kind == "cmp" and node[1] == "=" and node[3][1] != "n":
+            self.enable(node[2][1])
+        else:
+            self.unsatisfiable.append(node)
+
+    def enable(self, name: str, selected: bool = False):
+        if selected:
+            self.selected.add(name)
+        if name in self.on:
+            return
+        self.on.add(name)
+        sym = self.tree.symbols.get(name)
+        if sym is not None:
+            for dep in sym.depends:
+                self._satisfy(dep)
+            if not selected and sym.prompt_if is not None:
+                self._satisfy(sym.prompt_if)
+            for target, cond in sym.selects:
+                if cond is None or self._eval(cond):
+                    self.enable(target, selected=True)
+        self.order.append(name)
+
+    def explicit(self) -> list:
+        """Symbols that have to be written, in dependency order."""
+        result = []
+        for name in self.order:
+            sym = self.tree.symbols.get(name)
+            if name in self.selected:
+                continue
+            if sym is not None and (not sym.prompt or self._defaults_on(sym)):
+                continue
+            result.append(name)
+        return result
+
+
+def minimal_kunitconfig(tree: KconfigTree, targets: list, assume: set = (), extra: list = ()) -> str:
+    closure = KconfigClosure(tree, assume)
+    for name in ["KUNIT", *targets]:
+        closure.enable(name)
+    lines = [f"# Minimal kunitconfig for {', '.join(targets)} (Kconfig dependency closure)"]
+    lines += [f"CONFIG_{name}=y" for name in closure.explicit()]
+    lines += [f"CONFIG_{name}=y" for name in extra if f"CONFIG_{name}=y" not in lines]
+    return "\n".join(lines) + "\n"
+
+
+# Always on for the architectures kunit.py builds; never worth writing out
+ARCH_BASELINE = {
+    "x86": {"X86", "X86_64", "64BIT", "MMU", "HAS_IOMEM", "HAS_DMA", "PCI"},
+    "um": {"UML", "64BIT", "MMU"},
+}
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Derive the smallest kunitconfig that builds a driver and its tests.")
+    parser.add_argument("--kconfig", required=True, help="Kconfig to start from (a subsystem's or the kernel's top level)")
+    parser.add_argument("--makefile", required=True, help="Makefile that builds the driver object")
+    parser.add_argument("--object", required=True, help="driver object, e.g. pinctrl-amd.o")
+    parser.add_argument("--test", action="append", default=[], help="test config symbol(s) to enable as well")
+    parser.add_argument("--srctree", default=None)
+    parser.add_argument("--arch", default="x86")
+    parser.add_argument("-o", "--output", default=None)
+    args = parser.parse_args()
+
+    driver = config_for_object(Path(args.makefile), args.object)
+    if driver is None:
+        raise SystemExit(f"❌ {args.object} is not built by any obj-$(CONFIG_...) line in {args.makefile}")
+    tree = KconfigTree(Path(args.kconfig), Path(args.srctree) if args.srctree else None, args.arch)
+    tests = [t.removeprefix("CONFIG_") for t in args.test]
+    text = minimal_kunitconfig(tree, [driver, *tests], ARCH_BASELINE.get(args.arch, set()))
+    print(f"📦 Parsed {len(tree.symbols)} symbols from {len(tree.files)} Kconfig files; {args.object} -> CONFIG_{driver}")
+    if args.output:
+        Path(args.output).write_text(text, encoding="utf-8")
+        print(f"✅ Wrote {args.output}")
+    else:
+        print(text, end="")
@@ -0,0 +1,207 @@
+import os
+import re
+import subprocess
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import dataclass, field
+from pathlib import Path
+from KunitGeneration.kernel_build.compile_autofix import JSON_DIAGNOSTICS_FLAG
+
+KUNIT_TOOL = "./tools/testing/kunit/kunit.py"
+KTAP_RESULT = re.compile(r"^\s*(not ok|ok)\s+\d+\s+(?:-\s+)?([\w.-]+)(?:\s+#\s*(SKIP|TODO).*)?$")
+# Raw console output carries a printk timestamp per line when CONFIG_PRINTK_TIME=y
+PRINTK_TIME = re.compile(r"^\[\s*(\d+\.\d+)\]\s?(.*)$")
+
+# Options UML cannot provide; a kunitconfig enabling any of them has to boot under QEMU.
+UML_INCOMPATIBLE = re.compile(r"^CONFIG_(X86|ACPI|PCI|DMI|EFI)\w*=y", re.MULTILINE)
+
+
+@dataclass
+class ExecResult:
+    name: str
+    arch: str
+    returncode: int
+    seconds: float
+    log_path: Path
+    passed: list = field(default_factory=list)
+    failed: list = field(default_factory=list)
+    skipped: list = field(default_factory=list)
+
+    @property
+    def ok(self) -> bool:
+        return self.returncode == 0 and not self.failed
+
+
+def parse_ktap_results(log_text: str) -> tuple:
+    """(passed, failed, skipped) test and suite names from raw KTAP output."""
+    passed, failed, skipped = [], [], []
+    for line in log_text.splitlines():
+        stamped = PRINTK_TIME.match(line)
+        m = KTAP_RESULT.match(stamped.group(2) if stamped else line)
+        if not m:
+            continue
+        status, name, directive = m.groups()
+        if directive == "SKIP":
+            skipped.append(name)
+        elif status == "ok":
+            passed.append(name)
+        else:
+            failed.append(name)
+    return passed, failed, skipped
+
+
+def uml_compatible(kunitconfig: Path) -> bool:
+    try:
+        return not UML_INCOMPATIBLE.search(Path(kunitconfig).read_text(encoding="utf-8"))
+    except OSError:
+        return False
+
+
+class KunitRunner:
+    """
+    Runs `kunit.py build` and `kunit.py exec` as separate stages so compilation can be checked
+    without booting, and boots/executes in the background while the next build runs.
+
+    Builds rotate over `slots` build directories (double buffering with the default of 2):
+    slot k's kernel image is executing while the next build writes into slot k+1, and a
+    slot is only rebuilt once its previous exec has finished. With use_uml, kernels are
+    built for ARCH=um and run as a host process instead of under QEMU, when the kunitconfig
+    does not need x86/ACPI/PCI support. With json_diagnostics, GCC reports diagnostics as JSON
+    (see compile_autofix.parse_gcc_diagnostics) instead of caret text.
+    """
+
+    def __init__(self, kernel_dir: Path, kunitconfig: Path, arch: str = "x86_64", use_uml: bool = False,
+                 slots: int = 2, jobs: int = None, exec_timeout: int = 300, name: str = "kunit",
+                 json_diagnostics: bool = False):
+        self.kernel_dir = Path(kernel_dir)
+        self.kunitconfig = Path(kunitconfig)
+        self.arch = arch
+        if use_uml and not uml_compatible(self.kunitconfig):
+            print(f"⚠️ {self.kunitconfig.name} needs x86-only options; executing under QEMU ({arch}) instead of UML.")
+            use_uml = False
+        self.exec_arch = "um" if use_uml else arch
+        self.jobs = jobs
+        self.exec_timeout = exec_timeout
+        self.json_diagnostics = json_diagnostics
+        self.build_dirs = [self.kernel_dir / f".{name}_{self.exec_arch}_{i}" for i in range(max(1, slots))]
+        self._slot = 0
+        self._last_built = None
+        self._pending = {}                       # build dir -> Future of its exec
+        self._executor = ThreadPoolExecutor(max_workers=1, thread_name_prefix="kunit-exec")
+        self._lock = threading.Lock()
+        self.results = []
+
+    def _common_args(self, build_dir: Path) -> list:
+        return [f"--build_dir={build_dir}", f"--arch={self.exec_arch}"]
+
+    def _kcflags(self) -> list:
+        """KCFLAGS make option adding the JSON diagnostics flag to the caller's own KCFLAGS."""
+        if not self.json_diagnostics:
+            return []
+        flags = " ".join(f for f in (os.environ.get("KCFLAGS", ""), JSON_DIAGNOSTICS_FLAG) if f)
+        return [f"KCFLAGS={flags}"]
+
+    # ---------------- Build stage ----------------
+    def _wait_for_slot(self) -> Path:
+        """The next build directory, once any exec still booting from it has finished."""
+        build_dir = self.build_dirs[self._slot]
+        pending = self._pending.get(build_dir)
+        if pending is not None and not pending.done():
+            print(f"⏳ Waiting for the exec still using {build_dir.name}...")
+            pending.result()
+        return build_dir
+
+    def build(self, log_path: Path) -> bool:
+        """Configure + compile into the next free slot; output goes to log_path."""
+        build_dir = self._wait_for_slot()
+        cmd = [KUNIT_TOOL, "build", f"--kunitconfig={self.kunitconfig}", *self._common_args(build_dir)]
+        if self.jobs:
+            cmd.append(f"--jobs={self.jobs}")
+        cmd += [f"--make_options={opt}" for opt in self._kcflags()]
+        with open(log_path, "w", encoding="utf-8") as log:
+            proc = subprocess.run(cmd, cwd=self.kernel_dir, stdout=log, stderr=subprocess.STDOUT)
+        if proc.returncode != 0:
+            return False
+        self._last_built = build_dir
+        self._slot = (self._slot + 1) % len(self.build_dirs)
+        return True
+
+    def compile_objects(self, objects: list, log_path: Path) -> dict:
+        """
+        Compile just the given kernel-relative objects (e.g. drivers/gpio/x.o) with `make -k`
+        in one invocation, without linking. Returns {object: compiled}. Used to check several
+        candidate tests in a single build cycle; the build directory is configured first so
+        new test options from the kunitconfig are visible. Objects go into the slot the next
+        build() uses, never one an exec may be booting from, so that build reuses them.
+        """
+        build_dir = self._wait_for_slot()
+        start = time.time()
+        with open(log_path, "w", encoding="utf-8") as log:
+            subprocess.run([KUNIT_TOOL, "config", f"--kunitconfig={self.kunitconfig}", *self._common_args(build_dir)],
+                           cwd=self.kernel_dir, stdout=log, stderr=subprocess.STDOUT)
+            log.flush()
+            cmd = ["make", f"ARCH={self.exec_arch}", f"O={build_dir}", "-k", f"-j{self.jobs or os.cpu_count()}",
+                   *self._kcflags(), *objects]
+            subprocess.run(cmd, cwd=self.kernel_dir, stdout=log, stderr=subprocess.STDOUT)
+        compiled = {}
+        for obj in objects:
+            out = build_dir / obj
+            compiled[obj] = out.exists() and out.stat().st_mtime >= start - 1
+        return compiled
+
+    # ---------------- Exec stage ----------------
+    @property
+    def last_build_dir(self):
+        return self._last_built
+
+    def _exec(self, name: str, build_dir: Path, log_path: Path, filter_glob: str = None) -> ExecResult:
+        cmd = [KUNIT_TOOL, "exec", *self._common_args(build_dir), "--raw_output", f"--timeout={self.exec_timeout}"]
+        if filter_glob:
+            cmd.append(f"--filter_glob={filter_glob}")
+        start = time.perf_counter()
+        with open(log_path, "w", encoding="utf-8") as log:
+            proc = subprocess.run(cmd, cwd=self.kernel_dir, stdout=log, stderr=subprocess.STDOUT)
+        passed, failed, skipped = parse_ktap_results(Path(log_path).read_text(encoding="utf-8", errors="ignore"))
+        result = ExecResult(name, self.exec_arch, proc.returncode, time.perf_counter() - start,
+                            Path(log_path), passed, failed, skipped)
+        with self._lock:
+            self.results.append(result)
+        status = "✅" if result.ok else "❌"
+        print(f"{status} [{self.exec_arch}] {name}: {len(passed)} passed, {len(failed)} failed, "
+              f"{len(skipped)} skipped in {result.seconds:.1f}s")
+        return result
+
+    def exec_async(self, name: str, log_path: Path):
+        """Boot and run the last successful build in the background; returns a Future of ExecResult."""
+        if self._last_built is None:
+            raise RuntimeError("exec_async() called before a successful build()")
+        future = self._executor.submit(self._exec, name, self._last_built, log_path)
+        self._pending[self._last_built] = future
+        return future
+
+    def exec_now(self, name: str, log_path: Path, filter_glob: str = None) -> ExecResult:
+        """Run the last successful build in the foreground, optionally only the cases matching filter_glob."""
+        if self._last_built is None:
+            raise RuntimeError("exec_now() called before a successful build()")
+        pending = self._pending.get(self._last_built)
+        if pending is not None:
+            pending.result()
+        return self._exec(name, self._last_built, log_path, filter_glob)
+
+    def drain(self) -> list:
+        """Wait for every queued exec and return all results."""
+        for future in list(self._pending.values()):
+            future.result()
+        return list(self.results)
+
+
+if __name__ == "__main__":
+    # Self-check: printk timestamps (CONFIG_PRINTK_TIME=y, on when profiling) must not change the results
+    plain = ("KTAP version 1\n1..1\n    # Subtest: amdpt_test\n    1..3\n    ok 1 amdpt_probe_ok\n"
+             "    not ok 2 amdpt_probe_fails\n    ok 3 amdpt_irq # SKIP no irq\nnot ok 1 amdpt_test\n")
+    stamped = "".join(f"[    0.{412345 + i:06d}] {line}\n" for i, line in enumerate(plain.splitlines()))
+    expected = (["amdpt_probe_ok"], ["amdpt_probe_fails", "amdpt_test"], ["amdpt_irq"])
+    assert parse_ktap_results(plain) == expected, parse_ktap_results(plain)
+    assert parse_ktap_results(stamped) == expected, parse_ktap_results(stamped)
+    print("✅ Plain and timestamped KTAP output parse to the same results.")
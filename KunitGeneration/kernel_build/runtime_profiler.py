@@ -0,0 +1,237 @@
+import argparse
+import json
+import re
+import statistics
+import time
+from collections import defaultdict
+from dataclasses import dataclass, asdict
+from pathlib import Path
+from KunitGeneration.data_ingestion.dependency_slicer import SourceDependencySlicer, STRINGS_AND_COMMENTS
+from KunitGeneration.kernel_build.kunit_runner import KTAP_RESULT, PRINTK_TIME
+
+SUBTEST = re.compile(r"^\s*#\s*Subtest:\s*([\w.-]+)")
+
+# KUnit marks a case "slow" at one second (KUNIT_SPEED_SLOW)
+SLOW_SECONDS = 1.0
+# ...and we flag cases much slower than the rest of their suite
+OUTLIER_FACTOR = 5.0
+LARGE_MEMSET_BYTES = 4096
+
+SLEEPS = re.compile(r"\b(msleep(?:_interruptible)?|ssleep|usleep_range|fsleep|schedule_timeout\w*|"
+                    r"wait_for_completion_timeout|[mu]delay)\s*\(\s*([^,)]*)")
+EMPTY_LOOP = re.compile(r"\b(?:while\s*\([^;{}]*\)|for\s*\([^;{}]*;[^;{}]*;[^{}]*\))\s*;")
+CPU_RELAX = re.compile(r"\bcpu_relax\s*\(\s*\)")
+MEMSET = re.compile(r"\bmemset\s*\(\s*([\w.>\-\[\]]+)\s*,[^,]+,\s*([^;]+?)\)\s*;")
+STATIC_ARRAY = re.compile(r"\bstatic\b[^;=(]*?\b(\w+)\s*\[\s*(\w+)\s*\]")
+
+
+@dataclass
+class CaseTiming:
+    suite: str
+    case: str
+    seconds: float          # None when the log has no printk timestamps
+    status: str             # ok, fail, skip
+
+
+def parse_case_timings(log_text: str) -> list:
+    """
+    Per-case durations from raw KTAP console output: the time between a case's result line
+    and the previous result (or its suite's header). Parameterized cases are timed as a whole.
+    """
+    timings, stack, mark = [], [], None
+    for raw in log_text.splitlines():
+        m = PRINTK_TIME.match(raw)
+        stamp, line = (float(m.group(1)), m.group(2)) if m else (None, raw)
+        sub = SUBTEST.match(line)
+        if sub:
+            stack.append(sub.group(1))
+            if len(stack) == 1:
+                mark = stamp
+            continue
+        res = KTAP_RESULT.match(line)
+        if not res or not stack:
+            continue
+        status, name, directive = res.groups()
+        if name == stack[-1]:
+            stack.pop()
+            if not stack:
+                continue        # suite result
+            if len(stack) > 1:
+                continue        # nested deeper than a case
+        elif len(stack) > 1:
+            continue            # a parameter row of a parameterized case
+        seconds = round(stamp - mark, 6) if stamp is not None and mark is not None else None
+        verdict = "skip" if directive == "SKIP" else ("ok" if status == "ok" else "fail")
+        timings.append(CaseTiming(stack[0], name, seconds, verdict))
+        mark = stamp
+    return timings
+
+
+def scan_slow_patterns(code: str) -> dict:
+    """
+    {function: [hint, ...]} for code that is likely to burn wall-clock time in a test:
+    sleeps and delays, empty-bodied polling loops, and memsets of large static buffers.
+    """
+    sizes = {}
+    bare_file = STRINGS_AND_COMMENTS.sub(" ", code)
+    defines = dict(re.findall(r"#\s*define\s+(\w+)\s+\(?\s*(\d+)\s*\)?", bare_file))
+    for name, size in STATIC_ARRAY.findall(bare_file):
+        size = defines.get(size, size)
+        if size.isdigit():
+            sizes[name] = int(size)
+
+    def byte_count(expr: str):
+        expr = expr.strip()
+        expr = defines.get(expr, expr)
+        if expr.isdigit():
+            return int(expr)
+        m = re.fullmatch(r"sizeof\s*\(?\s*(\w+)\s*\)?", expr)
+        return sizes.get(m.group(1)) if m else None
+
+    hints = defaultdict(list)
+    for item in SourceDependencySlicer(code).items:
+        if item.kind != "function" or not item.names:
+            continue
+        name = next(iter(item.names))
+        bare = STRINGS_AND_COMMENTS.sub(" ", item.text)
+        for call, arg in SLEEPS.findall(bare):
+            kind = "busy-delays" if call.endswith("delay") else "sleeps"
+            hints[name].append(f"{kind}: {call}({arg.strip()})")
+        if EMPTY_LOOP.search(bare) or CPU_RELAX.search(bare):
+            hints[name].append("busy-wait loop")
+        for target, length in MEMSET.findall(bare):
+            n = byte_count(length)
+            if n is not None and n >= LARGE_MEMSET_BYTES:
+                hints[name].append(f"memset of {n} bytes ({target.strip()})")
+    return dict(hints)
+
+
+def case_hints(code: str, cases: list) -> dict:
+    """Slow-pattern hints per case, including those in mocks/helpers the case calls directly."""
+    hints = scan_slow_patterns(code)
+    slicer = SourceDependencySlicer(code)
+    result = {}
+    for case in cases:
+        item = slicer.definitions.get(case)
+        if item is None:
+            continue
+        found = list(hints.get(case, []))
+        for callee in sorted(item.refs & hints.keys()):
+            found += [f"{h} in {callee}()" for h in hints[callee]]
+        if found:
+            result[case] = found
+    return result
+
+
+class RuntimeProfile:
+    """
+    Persistent per-case timing history. Every exec log is appended as one run, so the
+    statistics sharpen as the same suites are executed again (locally or in CI), and are
+    aggregated per case, per suite and per driver into a ranked slow-test report.
+    """
+
+    def __init__(self, store_path: Path):
+        self.store_path = Path(store_path)
+        self.samples = []
+        if self.store_path.exists():
+            for line in self.store_path.read_text(encoding="utf-8").splitlines():
+                if line.strip():
+                    self.samples.append(json.loads(line))
+
+    def record(self, log_path: Path, driver: str = "", test_name: str = "") -> int:
+        """Add the case timings of one exec log; returns the number of timed cases."""
+        text = Path(log_path).read_text(encoding="utf-8", errors="ignore")
+        timings = [t for t in parse_case_timings(text) if t.seconds is not None]
+        if not timings:
+            return 0
+        run = time.time()
+        self.store_path.parent.mkdir(parents=True, exist_ok=True)
+        with open(self.store_path, "a", encoding="utf-8") as f:
+            for t in timings:
+                sample = {**asdict(t), "driver": driver, "test_name": test_name, "run": run}
+                f.write(json.dumps(sample) + "\n")
+                self.samples.append(sample)
+        return len(timings)
+
+    def aggregate(self) -> tuple:
+        """(cases, suites, drivers): per-case stats and summed medians per suite and driver."""
+        per_case = defaultdict(list)
+        owners = {}
+        for s in self.samples:
+            key = (s["suite"], s["case"])
+            per_case[key].append(s["seconds"])
+            owners[key] = (s.get("driver", ""), s.get("test_name", ""))
+        cases = []
+        for (suite, case), secs in per_case.items():
+            secs = sorted(secs)
+            cases.append({
+                "suite": suite, "case": case, "driver": owners[(suite, case)][0],
+                "test_name": owners[(suite, case)][1], "runs": len(secs),
+                "median": statistics.median(secs), "max": secs[-1],
+                "p90": secs[min(len(secs) - 1, int(0.9 * len(secs)))],
+            })
+        suites, drivers = defaultdict(float), defaultdict(float)
+        for c in cases:
+            suites[c["suite"]] += c["median"]
+            drivers[c["driver"] or "?"] += c["median"]
+        suite_medians = defaultdict(list)
+        for c in cases:
+            suite_medians[c["suite"]].append(c["median"])
+        for c in cases:
+            typical = statistics.median(suite_medians[c["suite"]])
+            c["slow"] = c["median"] >= SLOW_SECONDS
+            c["outlier"] = len(suite_medians[c["suite"]]) > 2 and c["median"] > OUTLIER_FACTOR * max(typical, 1e-3)
+        cases.sort(key=lambda c: c["median"], reverse=True)
+        return cases, dict(suites), dict(drivers)
+
+    def write_report(self, path: Path, sources: dict = None, top: int = 25) -> list:
+        """
+        Markdown report ranked by median case time. sources maps test_name -> test file and
+        adds the static slow-pattern hints of each flagged case. Returns the flagged cases.
+        """
+        cases, suites, drivers = self.aggregate()
+        hints = {}
+        for test_name, src in (sources or {}).items():
+            if Path(src).exists():
+                names = [c["case"] for c in cases if c["test_name"] == test_name]
+                for case, found in case_hints(Path(src).read_text(encoding="utf-8"), names).items():
+                    hints[(test_name, case)] = found
+        flagged = [c for c in cases if c["slow"] or c["outlier"] or (c["test_name"], c["case"]) in hints]
+
+        out = ["# KUnit runtime profile", "",
+               f"{len(self.samples)} samples, {len(cases)} cases, {len(suites)} suites.", "",
+               "## Drivers", "", "| driver | total median (s) |", "|---|---|"]
+        out += [f"| {d} | {s:.3f} |" for d, s in sorted(drivers.items(), key=lambda kv: -kv[1])]
+        out += ["", "## Suites", "", "| suite | cases | total median (s) |", "|---|---|---|"]
+        counts = defaultdict(int)
+        for c in cases:
+            counts[c["suite"]] += 1
+        out += [f"| {s} | {counts[s]} | {t:.3f} |" for s, t in sorted(suites.items(), key=lambda kv: -kv[1])]
+        out += ["", f"## Slowest cases (top {top})", "",
+                "| case | runs | median (s) | p90 (s) | max (s) | flags |", "|---|---|---|---|---|---|"]
+        for c in cases[:top]:
+            flags = [f for f, on in (("slow", c["slow"]), ("outlier", c["outlier"])) if on]
+            flags += hints.get((c["test_name"], c["case"]), [])
+            out.append(f"| {c['suite']}.{c['case']} | {c['runs']} | {c['median']:.3f} | {c['p90']:.3f} | "
+                       f"{c['max']:.3f} | {'; '.join(flags)} |")
+        Path(path).parent.mkdir(parents=True, exist_ok=True)
+        Path(path).write_text("\n".join(out) + "\n", encoding="utf-8")
+        return flagged
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Aggregate per-case KUnit runtimes from raw KTAP logs into a ranked report.")
+    parser.add_argument("logs", nargs="*", help="raw `kunit.py exec --raw_output` logs to add as runs")
+    parser.add_argument("--store", default="main_test_dir/profile/timings.jsonl")
+    parser.add_argument("--driver", default="")
+    parser.add_argument("--source", action="append", default=[], help="test_name=path/to/test.c for slow-pattern hints")
+    parser.add_argument("-o", "--output", default="main_test_dir/profile/slow_tests.md")
+    args = parser.parse_args()
+
+    profile = RuntimeProfile(Path(args.store))
+    for log in args.logs:
+        n = profile.record(Path(log), args.driver, Path(log).stem.removeprefix("exec_"))
+        print(f"⏱️  {log}: {n} timed cases" + ("" if n else " (no printk timestamps? enable CONFIG_PRINTK_TIME)"))
+    sources = dict(s.split("=", 1) for s in args.source)
+    flagged = profile.write_report(Path(args.output), sources)
+    print(f"✅ Wrote {args.output}; {len(flagged)} cases flagged.")
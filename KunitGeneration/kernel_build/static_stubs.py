@@ -0,0 +1,216 @@
+import re
+from pathlib import Path
+from KunitGeneration.data_ingestion.dependency_slicer import SourceDependencySlicer, STRINGS_AND_COMMENTS
+
+STATIC_STUB_HEADER = "kunit/static_stub.h"
+ATTRIBUTE = re.compile(r"__attribute__\s*\(\(.*?\)\)|\b__\w+\b")
+# A call in an initializer: `f(`, but not `sizeof(`, `(type)` casts or `__attribute__((...))`
+CALL = re.compile(r"\b(?!sizeof\b|typeof\b|__attribute__\b)[A-Za-z_]\w*\s*\(")
+LINE_BREAK = re.compile(r"\s*\n\s*")
+STATEMENT_KEYWORDS = {"return", "if", "else", "for", "while", "do", "switch", "case", "default", "goto",
+                      "break", "continue", "sizeof"}
+# `u32 val;`, `struct foo *p = container_of(...);`, `unsigned long flags, i;`, `char buf[16] = {0};`
+DECLARATION = re.compile(
+    r"^(?:(?:const|static|volatile|register|unsigned|signed|struct|union|enum)\s+)*[A-Za-z_]\w*"
+    r"(?:\s+(?:long|int|short|char|const))*[\s\*]+(?:const\s+)?\**\s*[A-Za-z_]\w*\s*(?:\[[^\]]*\]\s*)*(?:[=,;]|$)"
+)
+
+
+def stubbed_source_name(source_path: Path) -> str:
+    """Name of the instrumented copy tests include instead of the driver."""
+    return f"{Path(source_path).stem}_stubbed.c"
+
+
+def _matching(text: str, open_idx: int) -> int:
+    """Index of the bracket closing text[open_idx]."""
+    pairs = {"(": ")", "{": "}", "[": "]"}
+    closer, depth = pairs[text[open_idx]], 0
+    for i in range(open_idx, len(text)):
+        if text[i] == text[open_idx]:
+            depth += 1
+        elif text[i] == closer:
+            depth -= 1
+            if depth == 0:
+                return i
+    return -1
+
+
+def _split_top_level(text: str, sep: str) -> list:
+    parts, depth, start = [], 0, 0
+    for i, c in enumerate(text):
+        if c in "([{":
+            depth += 1
+        elif c in ")]}":
+            depth -= 1
+        elif c == sep and depth == 0:
+            parts.append(text[start:i])
+            start = i + 1
+    parts.append(text[start:])
+    return parts
+
+
+def parameter_names(header: str, name: str):
+    """Argument names of a function definition header; None for variadic or unparsable signatures."""
+    m = re.search(rf"\b{name}\s*\(", header)
+    if not m:
+        return None
+    close = _matching(header, m.end() - 1)
+    params = [p.strip() for p in _split_top_level(header[m.end():close], ",")]
+    if params in ([""], ["void"]):
+        return []
+    names = []
+    for p in params:
+        if p == "...":
+            return None
+        pointer = re.search(r"\(\s*\*\s*(\w+)\s*\)", p)
+        idents = re.findall(r"[A-Za-z_]\w*", ATTRIBUTE.sub(" ", re.sub(r"\[[^\]]*\]", "", p)))
+        if pointer:
+            names.append(pointer.group(1))
+        elif len(idents) >= 2:
+            names.append(idents[-1])
+        else:
+            return None
+    return names
+
+
+def _top_level(text: str, chars: str) -> list:
+    """Offsets of the characters of chars outside brackets (a lone '=', not '==' or '<=')."""
+    found, depth = [], 0
+    for i, c in enumerate(text):
+        if c in "([{":
+            depth += 1
+        elif c in ")]}":
+            depth -= 1
+        elif depth == 0 and c in chars:
+            if c == "=" and (text[i - 1:i] in ("=", "!", "<", ">") or text[i + 1:i + 2] == "="):
+                continue
+            found.append(i)
+    return found
+
+
+def _split_initializers(decl: str):
+    """
+    [(name, initializer start (before ' ='), end offset)] of the initialized declarators of a bare declaration, or
+    None when one cannot be assigned after the fact (arrays, brace initializers, const objects).
+    """
+    starts = [0] + [i + 1 for i in _top_level(decl, ",")]
+    ends = [i - 1 for i in starts[1:]] + [len(decl)]
+    first = decl[:ends[0]]
+    first = first[:(_top_level(first, "=") or [len(first)])[0]]
+    specifiers = first[:first.index("*")] if "*" in first else first.rsplit(None, 1)[0]
+    inits = []
+    for start, end in zip(starts, ends):
+        eq = _top_level(decl[start:end], "=")
+        if not eq:
+            continue
+        declarator = decl[start:start + eq[0]]
+        name = re.findall(r"[A-Za-z_]\w*", declarator)
+        qualifiers = declarator[declarator.rindex("*"):] if "*" in declarator else specifiers
+        if (not name or "[" in declarator or decl[start + eq[0] + 1:end].lstrip().startswith("{")
+                or re.search(r"\bconst\b", qualifiers)):
+            return None
+        inits.append((name[-1], len(decl[:start + eq[0]].rstrip()), end))
+    return inits
+
+
+def _redirect_plan(body: str, bare_body: str) -> tuple:
+    """
+    Where the redirect goes in a function body (after '{'): past its leading declarations, so it
+    adds no mixed code, but before any real code runs. From the first declaration whose
+    initializer calls something, initializers are split off: (offset, [(start, end, replacement)]
+    removing them, [assignment statements] to place after the redirect, in order).
+    """
+    offset, splitting, edits, assignments = 0, False, [], []
+    while True:
+        rest = bare_body[offset:]
+        stripped = rest.lstrip()
+        if not stripped or stripped[0] in "{}#":
+            return offset, edits, assignments
+        end, depth = -1, 0
+        for i, c in enumerate(stripped):
+            if c in "([{":
+                depth += 1
+            elif c in ")]}":
+                depth -= 1
+            elif c == ";" and depth == 0:
+                end = i
+                break
+        statement = " ".join(stripped[:end].split()) if end >= 0 else ""
+        first = re.match(r"\w+", statement)
+        if end < 0 or not first or first.group(0) in STATEMENT_KEYWORDS or not DECLARATION.match(statement):
+            return offset, edits, assignments
+        start = offset + len(rest) - len(stripped)
+        decl = bare_body[start:start + end]
+        eqs = _top_level(decl, "=")
+        splitting = splitting or bool(eqs and CALL.search(decl[eqs[0] + 1:]))
+        if splitting and first.group(0) != "static":
+            inits = _split_initializers(decl)
+            if inits is None:
+                # Cannot defer this initializer: redirect before it, with the assignments so far
+                return offset, edits, assignments
+            for name, eq, stop in inits:
+                value = STRINGS_AND_COMMENTS.sub(lambda m: " " if m.group(0)[0] == "/" else m.group(0),
+                                                 body[start + eq:start + stop].lstrip()[1:])
+                # Line count unchanged: the initializer's newlines stay where it was
+                edits.append((start + eq, start + stop, "\n" * body.count("\n", start + eq, start + stop)))
+                # Joined onto one line; strings cannot span lines, so their spacing is kept
+                assignments.append(f"{name} = {LINE_BREAK.sub(' ', value).strip()};")
+        offset = start + end + 1
+
+
+def instrument(source_code: str, source_name: str, skip: set = ()) -> tuple:
+    """
+    (instrumented source, instrumented function names). Every driver function gets a
+    KUNIT_STATIC_STUB_REDIRECT after its local declarations, so a test can replace it with
+    kunit_activate_static_stub() at run time. Initializers that call code become assignments
+    after the redirect, so a stubbed function runs none of its own code. Redirects are inserted
+    on existing lines and a #line directive follows the added include, so diagnostics and gcov
+    still point at the driver's own lines.
+    """
+    slicer = SourceDependencySlicer(source_code)
+    edits, names = [], []
+    for item in slicer.items:
+        if item.kind != "function" or not item.names:
+            continue
+        name = next(iter(item.names))
+        # Comments and strings blanked out, offsets unchanged
+        bare = re.sub(STRINGS_AND_COMMENTS, lambda m: re.sub(r"[^\n]", " ", m.group(0)), item.text)
+        brace = bare.index("{")
+        args = parameter_names(bare[:brace], name)
+        if name in skip or args is None:
+            continue
+        body_start, body_end = brace + 1, bare.rindex("}")
+        offset, splits, assignments = _redirect_plan(item.text[body_start:body_end], bare[body_start:body_end])
+        base = item.start + body_start
+        edits.extend((base + start, base + end, text) for start, end, text in splits)
+        redirect = f" KUNIT_STATIC_STUB_REDIRECT({', '.join([name] + args)});"
+        edits.append((base + offset, base + offset, redirect + "".join(f" {a}" for a in assignments)))
+        names.append(name)
+
+    code = source_code
+    for start, end, text in sorted(edits, reverse=True):
+        code = code[:start] + text + code[end:]
+    header = f"#include <{STATIC_STUB_HEADER}>\n#line 1 \"{source_name}\"\n"
+    return header + code, names
+
+
+class StaticStubDriver:
+    """
+    Writes the statically-stubbed copy of a driver next to it. Tests include the copy instead
+    of the driver and mock its functions at run time, so every test shares the same driver
+    code: no per-test #define mock sets, one amalgamated suite, one driver compile per build.
+    The copy is only rewritten when it changes so make does not rebuild it needlessly.
+    """
+
+    def __init__(self, source_path: Path, out_dir: Path):
+        self.source_path = Path(source_path)
+        self.include_name = stubbed_source_name(self.source_path)
+        self.path = Path(out_dir) / self.include_name
+        self.functions = []
+
+    def write(self, skip: set = ()) -> Path:
+        source = self.source_path.read_text(encoding="utf-8", errors="ignore")
+        code, self.functions = instrument(source, self.source_path.name, skip)
+        if not self.path.exists() or self.path.read_text(encoding="utf-8", errors="ignore") != code:
+            self.path.write_text(code, encoding="utf-8")
+        return self.path
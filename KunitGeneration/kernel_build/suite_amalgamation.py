@@ -0,0 +1,139 @@
+import re
+from pathlib import Path
+
+
+class SuiteAmalgamator:
+    """
+    Merges the passing per-function KUnit tests of one driver source into a single
+    compilation unit that includes the driver (or its shared harness) exactly once.
+    Every function keeps its own kunit_suite, so results stay attributable per function.
+    """
+
+    SUITE_REGISTRATION = re.compile(r"^\s*kunit_test_suites?\s*\(([^;]*)\)\s*;\s*$", re.MULTILINE)
+    STATIC_SYMBOL = re.compile(r"^static\s+[^;=(\[{]*?\**\b(\w+)\s*(?:\(|\[|=|;)", re.MULTILINE)
+    DEFINE_NAME = re.compile(r"#\s*define\s+(\w+)")
+    GLOBAL_FUNCTION = re.compile(r"^(?!static\b)[A-Za-z_][\w \t\*]*?\b(\w+)\s*\([^;{]*\)\s*\{", re.MULTILINE)
+
+    def __init__(self, source_path: Path, output_dir: Path, harness_name: str = None, include_name: str = None):
+        self.source_path = Path(source_path)
+        self.output_dir = Path(output_dir)
+        # include_name: what the tests include instead of the driver, e.g. its statically-stubbed copy
+        self.anchor_includes = {f'"{include_name or self.source_path.name}"'}
+        if harness_name:
+            self.anchor_includes.add(f'"{harness_name}"')
+        stem = re.sub(r"\W+", "_", self.source_path.stem)
+        self.test_name = f"{stem}_kunit_suite"
+        self.output_file = self.output_dir / f"{self.test_name}.c"
+
+    # ---------------- Parsing ----------------
+    @staticmethod
+    def _logical_lines(text: str) -> list:
+        """Split into lines, joining backslash-continued #define bodies."""
+        lines, buf = [], ""
+        for line in text.splitlines():
+            if buf or line.lstrip().startswith("#"):
+                buf += line + "\n"
+                if line.rstrip().endswith("\\"):
+                    continue
+                lines.append(buf.rstrip("\n"))
+                buf = ""
+            else:
+                lines.append(line)
+        if buf:
+            lines.append(buf.rstrip("\n"))
+        return lines
+
+    def _split_unit(self, func_name: str, text: str):
+        """Return (includes, defines, pre_decls, body, anchor, suites) or None if the test cannot be merged."""
+        includes, defines, pre_decls, body = [], [], [], []
+        anchor = None
+        for line in self._logical_lines(text):
+            inc = re.match(r"\s*#\s*include\s+([<\"][^>\"]+[>\"])", line)
+            if inc and inc.group(1) in self.anchor_includes:
+                anchor = line.strip()
+                continue
+            if anchor is None:
+                if inc:
+                    includes.append(line.strip())
+                elif self.DEFINE_NAME.match(line.strip()):
+                    defines.append(line.strip())
+                else:
+                    pre_decls.append(line)
+            else:
+                body.append(line)
+
+        if anchor is None:
+            print(f"⚠️ {func_name}: no '#include' of {' or '.join(sorted(self.anchor_includes))}; keeping it standalone.")
+            return None
+
+        body_text = "\n".join(body)
+        suites = []
+        for match in self.SUITE_REGISTRATION.finditer(body_text):
+            suites += [s.strip().lstrip("&") for s in match.group(1).split(",") if s.strip()]
+        if not suites:
+            print(f"⚠️ {func_name}: no kunit_test_suite() registration; keeping it standalone.")
+            return None
+        body_text = self.SUITE_REGISTRATION.sub("", body_text)
+        return includes, defines, "\n".join(pre_decls), body_text, anchor, suites
+
+    # ---------------- Merging ----------------
+    def amalgamate(self, test_files: dict) -> Path:
+        """
+        test_files maps function name -> passing per-function test file.
+        Returns the merged file, or None when fewer than two tests could be merged.
+        """
+        units = {}
+        for func_name, path in test_files.items():
+            parsed = self._split_unit(func_name, Path(path).read_text(encoding="utf-8"))
+            if parsed:
+                units[func_name] = parsed
+
+        # Mock #defines must precede the single driver include and non-static mocks share one
+        # namespace, so tests that disagree on either cannot be merged.
+        defines, global_funcs = {}, set()
+        for func_name in list(units):
+            _, unit_define_lines, pre, body, _, _ = units[func_name]
+            unit_defines = {self.DEFINE_NAME.match(d).group(1): d for d in unit_define_lines}
+            unit_funcs = set(self.GLOBAL_FUNCTION.findall(pre + "\n" + body))
+            clash = [n for n, d in unit_defines.items() if n in defines and defines[n] != d]
+            clash += sorted(unit_funcs & global_funcs)
+            if clash:
+                print(f"⚠️ {func_name}: conflicting mocks {', '.join(clash)}; keeping it standalone.")
+                del units[func_name]
+                continue
+            defines.update(unit_defines)
+            global_funcs |= unit_funcs
+
+        if len(units) < 2:
+            print("ℹ️ Not enough mergeable tests to amalgamate.")
+            return None
+
+        # File-scope statics with the same name in several tests get a per-function prefix.
+        owners = {}
+        for func_name, (_, _, pre, body, _, _) in units.items():
+            for sym in set(self.STATIC_SYMBOL.findall(pre + "\n" + body)):
+                owners.setdefault(sym, []).append(func_name)
+        collisions = {sym for sym, funcs in owners.items() if len(funcs) > 1}
+
+        includes, anchor, pre_sections, sections, all_suites = [], None, [], [], []
+        for func_name, (unit_includes, _, pre, body, unit_anchor, suites) in units.items():
+            includes += [i for i in unit_includes if i not in includes]
+            anchor = anchor or unit_anchor
+            for sym in collisions:
+                pattern = rf"\b{re.escape(sym)}\b"
+                pre, body = re.sub(pattern, f"{func_name}__{sym}", pre), re.sub(pattern, f"{func_name}__{sym}", body)
+                suites = [f"{func_name}__{s}" if s == sym else s for s in suites]
+            if pre.strip():
+                pre_sections.append(f"/* {func_name} mocks */\n{pre.strip()}\n")
+            sections.append(f"/* ---------------- {func_name} ---------------- */\n{body.strip()}\n")
+            all_suites += suites
+
+        registration = "kunit_test_suites(" + ",\n\t\t  ".join(f"&{s}" for s in all_suites) + ");"
+        merged = "\n".join(
+            [f"// SPDX-License-Identifier: GPL-2.0",
+             f"/* Amalgamated KUnit suites for {self.source_path.name}: {', '.join(units)} */"]
+            + includes + pre_sections + list(defines.values()) + [anchor, ""] + sections + [registration, ""]
+        )
+        self.output_file.write_text(merged, encoding="utf-8")
+        print(f"🧬 Amalgamated {len(units)} tests into {self.output_file}")
+        return self.output_file
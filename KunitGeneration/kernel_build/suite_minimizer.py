@@ -0,0 +1,198 @@
+import json
+import re
+import subprocess
+from pathlib import Path
+from KunitGeneration.data_ingestion.dependency_slicer import SourceDependencySlicer
+from KunitGeneration.kernel_build.kunit_runner import KunitRunner, uml_compatible
+
+# Whole-kernel gcov under UML, as in the KUnit coverage documentation
+COVERAGE_OPTIONS = [
+    "CONFIG_DEBUG_KERNEL=y",
+    "CONFIG_DEBUG_INFO=y",
+    "CONFIG_DEBUG_INFO_DWARF_TOOLCHAIN_DEFAULT=y",
+    "CONFIG_GCOV=y",
+]
+
+KUNIT_CASE = re.compile(r"^[ \t]*KUNIT_CASE\w*\(\s*(\w+)\s*[,)].*\n?", re.MULTILINE)
+SUITE_NAME = re.compile(r"struct\s+kunit_suite\s+\w+\s*=\s*\{[^}]*?\.name\s*=\s*\"([^\"]+)\"", re.DOTALL)
+
+
+def suite_cases(code: str) -> tuple:
+    """(suite name, [case function names]) of a single-suite test file."""
+    suite = SUITE_NAME.search(code)
+    return (suite.group(1) if suite else None), KUNIT_CASE.findall(code)
+
+
+def drop_cases(code: str, dropped: set) -> str:
+    """Remove the KUNIT_CASE entries and the case function definitions of dropped cases."""
+    slicer = SourceDependencySlicer(code)
+    spans = sorted(((item.start, item.start + len(item.text)) for item in slicer.items
+                    if item.kind == "function" and item.names & dropped), reverse=True)
+    for start, end in spans:
+        # Keep a single blank line where the function was
+        code = code[:start].rstrip("\n") + "\n\n" + code[end:].lstrip("\n")
+    return KUNIT_CASE.sub(lambda m: "" if m.group(1) in dropped else m.group(0), code)
+
+
+class SuiteMinimizer:
+    """
+    Coverage-preserving minimization of a generated suite: builds it with gcov under UML,
+    runs every case alone to record the lines and branches it covers in the code under
+    test (the driver and any local copy of the function, not the cases themselves), then
+    greedily keeps the cases that add coverage, largest first. The minimized suite must
+    build and pass with the normal runner, otherwise the original is restored.
+    """
+
+    def __init__(self, generator, source_path: Path = None):
+        self.generator = generator
+        self.source_name = Path(source_path).name if source_path else None
+        self.coverage_config = generator.base_dir / "kunitconfig" / "coverage.kunitconfig"
+        self.runner = None
+
+    def _coverage_runner(self):
+        base = self.generator.config_file.read_text(encoding="utf-8") if self.generator.config_file.exists() else ""
+        self.coverage_config.parent.mkdir(parents=True, exist_ok=True)
+        self.coverage_config.write_text(base.rstrip() + "\n" + "\n".join(COVERAGE_OPTIONS) + "\n", encoding="utf-8")
+        if not uml_compatible(self.coverage_config):
+            return None
+        if self.runner is None:
+            self.runner = KunitRunner(self.generator.kernel_dir, self.coverage_config, use_uml=True,
+                                      slots=1, name="kunit_cov")
+        return self.runner
+
+    def require_coverage(self):
+        """Fail before any generation when the kunitconfig cannot build under UML with gcov."""
+        if self._coverage_runner() is None:
+            raise ValueError(f"minimize_suites needs a UML-compatible kunitconfig, but '{self.generator.config_file}' "
+                             f"needs x86/ACPI/PCI; per-case coverage cannot be collected for this driver.")
+
+    # ---------------- Coverage ----------------
+    def _reset_counters(self, build_dir: Path):
+        for gcda in build_dir.rglob("*.gcda"):
+            gcda.unlink(missing_ok=True)
+
+    def _collect(self, build_dir: Path, test_file: str, case_lines: set) -> set:
+        """Covered ("L", file, line) and ("B", file, line, index) units from the .gcda files of the test dir."""
+        rel_dir = self.generator.makefile_path.parent.relative_to(self.generator.kernel_dir)
+        covered = set()
+        for gcda in (build_dir / rel_dir).glob("*.gcda"):
+            proc = subprocess.run(["gcov", "--json-format", "--stdout", "--branch-probabilities",
+                                   "--object-directory", str(gcda.parent), str(gcda)],
+                                  cwd=build_dir, capture_output=True, text=True)
+            for doc in proc.stdout.splitlines():
+                try:
+                    report = json.loads(doc)
+                except ValueError:
+                    continue
+                for f in report.get("files", []):
+                    name = Path(f["file"]).name
+                    if name not in (test_file, self.source_name):
+                        continue
+                    for line in f.get("lines", []):
+                        n = line["line_number"]
+                        if name == test_file and n in case_lines:
+                            continue
+                        if line.get("count", 0) > 0:
+                            covered.add(("L", name, n))
+                        for i, branch in enumerate(line.get("branches", [])):
+                            if branch.get("count", 0) > 0:
+                                covered.add(("B", name, n, i))
+        return covered
+
+    @staticmethod
+    def _case_lines(code: str, cases: list) -> set:
+        lines = set()
+        for item in SourceDependencySlicer(code).items:
+            if item.kind == "function" and item.names & set(cases):
+                first = code.count("\n", 0, item.start) + 1
+                lines.update(range(first, first + item.text.count("\n") + 1))
+        return lines
+
+    @staticmethod
+    def _verified(result, suite: str, kept: list, failing: set) -> bool:
+        """
+        The minimized suite ran: every kept case is reported and only known-failing cases (and
+        their suite) failed. A crash, timeout or missing KTAP output reports nothing, so it fails.
+        """
+        reported = set(result.passed) | set(result.failed) | set(result.skipped)
+        if not set(kept) <= reported:
+            return False
+        if result.returncode != 0 and not result.failed:
+            return False
+        return set(result.failed) <= failing | ({suite} if failing else set())
+
+    # ---------------- Minimization ----------------
+    def minimize(self, test_name: str) -> bool:
+        gen = self.generator
+        test_file = gen.output_dir / f"{test_name}.c"
+        original = test_file.read_text(encoding="utf-8")
+        suite, cases = suite_cases(original)
+        if suite is None or len(cases) < 2:
+            return False
+        runner = self._coverage_runner()
+        if runner is None:
+            print(f"⚠️ {test_name}: per-case coverage needs UML and the config needs x86/ACPI/PCI; not minimizing.")
+            return False
+
+        print(f"\n✂️  Minimizing {test_name} ({len(cases)} cases) by per-case coverage...")
+        # _update_makefile comments out the other tests' entries; put them back afterwards
+        makefile = gen.makefile_path.read_text(encoding="utf-8") if gen.makefile_path.exists() else None
+        try:
+            return self._minimize(test_name, test_file, original, suite, cases, runner)
+        finally:
+            if makefile is not None and gen.makefile_path.read_text(encoding="utf-8") != makefile:
+                gen.makefile_path.write_text(makefile, encoding="utf-8")
+                print("📝 Restored the Makefile entries of the other tests.")
+
+    def _minimize(self, test_name: str, test_file: Path, original: str, suite: str, cases: list, runner) -> bool:
+        gen = self.generator
+        gen._update_makefile(test_name)
+        gen._update_kconfig(test_name)
+        gen._update_test_config(test_name)
+        gen._sync_generated_files()
+        log_dir = gen.error_log_file.parent
+        if not runner.build(log_dir / f"coverage_build_{test_name}.txt"):
+            print(f"⚠️ Coverage build of {test_name} failed; not minimizing.")
+            return False
+
+        case_lines = self._case_lines(original, cases)
+        coverage, failing = {}, set()
+        for case in cases:
+            self._reset_counters(runner.last_build_dir)
+            result = runner.exec_now(f"{suite}.{case}", log_dir / f"coverage_exec_{test_name}.txt",
+                                     filter_glob=f"{suite}.{case}")
+            if not result.ok:
+                failing.add(case)
+            coverage[case] = self._collect(runner.last_build_dir, test_file.name, case_lines)
+        if not any(coverage.values()):
+            print(f"⚠️ No gcov data for {test_name}; not minimizing.")
+            return False
+
+        kept, covered = [], set()
+        for case in sorted(cases, key=lambda c: (-len(coverage[c]), cases.index(c))):
+            # Failing cases are kept: they are findings, not redundancy
+            if case in failing or coverage[case] - covered:
+                kept.append(case)
+                covered |= coverage[case]
+        dropped = set(cases) - set(kept)
+        if not dropped:
+            print(f"✅ {test_name}: every case adds coverage; nothing to drop.")
+            return False
+
+        lines = sum(1 for u in covered if u[0] == "L")
+        branches = sum(1 for u in covered if u[0] == "B")
+        test_file.write_text(drop_cases(original, dropped), encoding="utf-8")
+        print(f"✂️  Keeping {len(kept)}/{len(cases)} cases ({lines} lines, {branches} branches); "
+              f"dropped: {', '.join(c for c in cases if c in dropped)}")
+
+        # Re-verify the leaner suite with the normal runner before keeping it
+        if gen._compile_and_check():
+            result = gen.runner.exec_now(test_name, log_dir / f"exec_{test_name}_minimized.txt")
+            if self._verified(result, suite, kept, failing):
+                print(f"🎉 Minimized {test_name}: {len(original.splitlines())} -> "
+                      f"{len(test_file.read_text(encoding='utf-8').splitlines())} lines.")
+                return True
+        print(f"❌ Minimized {test_name} did not verify; restoring the original suite.")
+        test_file.write_text(original, encoding="utf-8")
+        gen._compile_and_check()
+        return False
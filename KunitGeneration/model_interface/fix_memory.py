@@ -0,0 +1,128 @@
+import difflib
+import hashlib
+import json
+import re
+import time
+from dataclasses import dataclass, field, asdict
+from pathlib import Path
+from KunitGeneration.kernel_build.compile_autofix import parse_gcc_diagnostics
+
+QUOTED = re.compile(r"'([^']*)'")
+NUMBER = re.compile(r"\b\d+\b")
+WORD = re.compile(r"[A-Za-z_]+")
+
+
+@dataclass(frozen=True)
+class ErrorSignature:
+    """A compiler error with locations stripped: the message shape plus the names it quoted."""
+    shape: str
+    names: tuple = ()
+
+    @classmethod
+    def from_message(cls, message: str):
+        names = tuple(QUOTED.findall(message))
+        shape = NUMBER.sub("N", QUOTED.sub("'_'", message)).strip()
+        return cls(shape, names)
+
+    @property
+    def text(self) -> str:
+        names = iter(self.names)
+        return re.sub(r"'_'", lambda m: f"'{next(names, '_')}'", self.shape)
+
+    def similarity(self, other) -> float:
+        if self.shape == other.shape:
+            return 1.0 if self.names == other.names else 0.6
+        a, b = set(WORD.findall(self.shape)), set(WORD.findall(other.shape))
+        jaccard = len(a & b) / len(a | b) if a | b else 0.0
+        return 0.4 * jaccard if jaccard >= 0.5 else 0.0
+
+
+def signatures_from_log(log_text: str) -> list:
+    """Unique error signatures of a build log, in the order they occur."""
+    seen = {}
+    for diag in parse_gcc_diagnostics(log_text):
+        if diag.severity in ("error", "fatal error"):
+            sig = ErrorSignature.from_message(diag.message)
+            seen.setdefault(sig, None)
+    return list(seen)
+
+
+@dataclass
+class FixRecord:
+    signatures: list
+    diff: str
+    test_name: str = ""
+    created: float = field(default_factory=time.time)
+
+    @property
+    def key(self) -> str:
+        return hashlib.sha1(self.diff.encode()).hexdigest()[:16]
+
+
+class FixMemory:
+    """
+    Persistent error-signature -> fix store. When a failing test later compiles, the diff
+    between the failing and the passing version is saved under the failing build's error
+    signatures; later failures retrieve the closest fixes as few-shot repair examples.
+    """
+
+    MAX_DIFF_LINES = 60
+
+    def __init__(self, store_path: Path):
+        self.store_path = Path(store_path)
+        self.records = []
+        if self.store_path.exists():
+            for line in self.store_path.read_text(encoding="utf-8").splitlines():
+                if line.strip():
+                    entry = json.loads(line)
+                    entry["signatures"] = [ErrorSignature(s["shape"], tuple(s["names"])) for s in entry["signatures"]]
+                    self.records.append(FixRecord(**entry))
+        self._keys = {r.key for r in self.records}
+
+    def __len__(self):
+        return len(self.records)
+
+    @classmethod
+    def _diff(cls, before: str, after: str, name: str) -> str:
+        lines = list(difflib.unified_diff(before.splitlines(), after.splitlines(),
+                                          f"a/{name}", f"b/{name}", n=2, lineterm=""))
+        if len(lines) > cls.MAX_DIFF_LINES:
+            lines = lines[:cls.MAX_DIFF_LINES] + ["... (diff truncated)"]
+        return "\n".join(lines)
+
+    def record(self, signatures: list, before: str, after: str, test_name: str = "") -> bool:
+        """Store the fix for signatures; returns False when there is nothing new to learn."""
+        if not signatures or before == after:
+            return False
+        rec = FixRecord(list(signatures), self._diff(before, after, f"{test_name or 'test'}.c"), test_name)
+        if rec.key in self._keys:
+            return False
+        self.store_path.parent.mkdir(parents=True, exist_ok=True)
+        entry = asdict(rec)
+        entry["signatures"] = [{"shape": s.shape, "names": list(s.names)} for s in rec.signatures]
+        with open(self.store_path, "a", encoding="utf-8") as f:
+            f.write(json.dumps(entry) + "\n")
+        self.records.append(rec)
+        self._keys.add(rec.key)
+        return True
+
+    def lookup(self, signatures: list, k: int = 2) -> list:
+        """Best k (score, FixRecord) for the given errors; score sums each error's best match."""
+        scored = []
+        for rec in self.records:
+            score = sum(max((q.similarity(s) for s in rec.signatures), default=0.0) for q in signatures)
+            if score > 0:
+                # Smaller diffs are the clearer examples when scores tie
+                scored.append((score, -len(rec.diff), rec))
+        scored.sort(key=lambda t: (t[0], t[1]), reverse=True)
+        return [(score, rec) for score, _, rec in scored[:k]]
+
+    @staticmethod
+    def format_examples(matches: list) -> str:
+        if not matches:
+            return "// No similar errors fixed before"
+        blocks = []
+        for i, (_, rec) in enumerate(matches, start=1):
+            errors = "\n".join(f"error: {s.text}" for s in rec.signatures[:5])
+            blocks.append(f"### Example {i}\nErrors:\n{errors}\nFix that made it compile:\n{rec.diff}")
+        return "\n\n".join(blocks)
@@ -0,0 +1,113 @@
+import re
+from pathlib import Path
+from KunitGeneration.model_interface.prompts.unittest_kunit_prompts import kunit_harness_prompt, kunit_harness_mock_rules
+
+
+class DriverHarnessBuilder:
+    """
+    Produces one validated test harness header per driver source file. The harness holds the
+    includes, fake MMIO, dependency mocks and fixtures, so per-function tests only add test cases.
+    """
+
+    LOGGING_MACROS = re.compile(r"^\s*#\s*define\s+(dev_\w+|pr_\w+|printk)\b", re.MULTILINE)
+
+    def __init__(self, generator, source_path: Path):
+        self.generator = generator
+        self.source_path = Path(source_path)
+        self.source_name = self.source_path.name
+        # The statically-stubbed copy in static_stub mode, the driver itself otherwise
+        self.include_name = generator.driver_include or self.source_name
+        stem = re.sub(r"\W+", "_", self.source_path.stem)
+        self.harness_name = f"{stem}_kunit_harness.h"
+        self.harness_path = generator.output_dir / self.harness_name
+        self.guard = f"{stem.upper()}_KUNIT_HARNESS_H"
+        self.probe_name = f"{stem}_harness_kunit_test"
+
+    # ---------------- Validation ----------------
+    def validate(self, header: str, source_code: str) -> list:
+        """Static checks for the mistakes that show up in compile_error.txt."""
+        problems = []
+        if not re.search(rf"#\s*ifndef\s+{self.guard}\b", header):
+            problems.append(f"missing include guard {self.guard}")
+        if "<kunit/test.h>" not in header:
+            problems.append("missing #include <kunit/test.h>")
+        driver_includes = len(re.findall(rf'#\s*include\s+"{re.escape(self.include_name)}"', header))
+        if driver_includes != 1:
+            problems.append(f'driver must be included exactly once with #include "{self.include_name}" (found {driver_includes})')
+        for macro in self.LOGGING_MACROS.findall(header):
+            problems.append(f"warning: \"{macro}\" redefined (do not mock kernel logging macros)")
+        driver_structs = set(re.findall(r"^struct\s+(\w+)\s*\{", source_code, re.MULTILINE))
+        for name in set(re.findall(r"^struct\s+(\w+)\s*\{", header, re.MULTILINE)) & driver_structs:
+            problems.append(f"error: redefinition of 'struct {name}' (already defined by {self.source_name})")
+        driver_macros = set(re.findall(r"^\s*#\s*define\s+(\w+)", source_code, re.MULTILINE))
+        for name in set(re.findall(r"^\s*#\s*define\s+(\w+)", header, re.MULTILINE)) & driver_macros:
+            problems.append(f"warning: \"{name}\" redefined (already defined by {self.source_name})")
+        if re.search(r"\bkunit_test_suite\s*\(|\bKUNIT_CASE\s*\(", header):
+            problems.append("harness must not define test cases or register a suite")
+        return problems
+
+    def _probe_test(self) -> str:
+        return (
+            f'#include "{self.harness_name}"\n\n'
+            f"static void {self.probe_name}_loads(struct kunit *test)\n"
+            "{\n\tKUNIT_EXPECT_TRUE(test, true);\n}\n\n"
+            f"static struct kunit_case {self.probe_name}_cases[] = {{\n"
+            f"\tKUNIT_CASE({self.probe_name}_loads),\n\t{{}}\n}};\n\n"
+            f"static struct kunit_suite {self.probe_name}_suite = {{\n"
+            f'\t.name = "{self.probe_name}",\n'
+            f"\t.test_cases = {self.probe_name}_cases,\n}};\n\n"
+            f"kunit_test_suite({self.probe_name}_suite);\n"
+        )
+
+    def _compile_probe(self) -> bool:
+        """Build a one-case suite that only includes the harness."""
+        probe_file = self.generator.output_dir / f"{self.probe_name}.c"
+        probe_file.write_text(self._probe_test(), encoding="utf-8")
+        try:
+            self.generator._update_makefile(self.probe_name)
+            self.generator._update_kconfig(self.probe_name)
+            self.generator._update_test_config(self.probe_name)
+            # Errors are reported against the harness lines, not the throwaway probe
+            self.generator.current_test_file = self.harness_path
+            return self.generator._compile_and_check()
+        finally:
+            probe_file.unlink(missing_ok=True)
+
+    # ---------------- Generation ----------------
+    def build(self, force: bool = False) -> Path:
+        """Return the harness path, generating and validating it only if it does not exist yet."""
+        # A harness written for the other mocking mode includes the wrong driver file
+        if (self.harness_path.exists() and not force
+                and f'"{self.include_name}"' in self.harness_path.read_text(encoding="utf-8")):
+            print(f"♻️  Reusing test harness {self.harness_path}")
+            return self.harness_path
+
+        source_code = self.source_path.read_text(encoding="utf-8", errors="ignore")
+        error_logs = "// No previous problems"
+        header = ""
+        for attempt in range(1, self.generator.max_retries + 1):
+            print(f"\n🧱 Generating test harness for {self.source_name} (Attempt {attempt}/{self.generator.max_retries})...")
+            prompt = kunit_harness_prompt.format(
+                harness_name=self.harness_name,
+                source_name=self.source_name,
+                include_name=self.include_name,
+                mock_rule=kunit_harness_mock_rules[self.generator.mock_mode],
+                source_code=source_code,
+                error_logs=error_logs,
+                guard=self.guard,
+            )
+            header = self.generator._query_model(prompt)
+            self.harness_path.write_text(header, encoding="utf-8")
+
+            problems = self.validate(header, source_code)
+            if problems:
+                error_logs = "\n".join(problems)
+                print(f"❌ Harness has {len(problems)} problems, regenerating...")
+                continue
+            if self._compile_probe():
+                print(f"✅ Test harness validated: {self.harness_path}")
+                return self.harness_path
+            error_logs = self.generator.error_log_file.parent.joinpath("clean_compile_errors.txt").read_text(encoding="utf-8")
+
+        print(f"⚠️ Harness for {self.source_name} still has problems; tests will include it as-is.")
+        return self.harness_path
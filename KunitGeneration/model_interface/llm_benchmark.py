@@ -0,0 +1,119 @@
+import argparse
+import statistics
+import time
+from pathlib import Path
+from KunitGeneration.model_interface.patch_repair import PatchRepair
+from KunitGeneration.model_interface.usage_ledger import UsageLedger
+
+
+def static_prompt(generator, func_file: Path) -> str:
+    """First-attempt prompt of a function, without previous tests or errors."""
+    func_code = func_file.read_text(encoding="utf-8")
+    dependency_slice = "// Driver source not available"
+    if generator.slicer is not None:
+        dependency_slice = generator.slicer.slice_for(func_file.stem) or "// No dependencies found"
+    return generator.prompt_template.format(
+        func_code=func_code, dependency_slice=dependency_slice, header_hints="// None",
+        retrieved_text="\n\n".join(generator._retrieve_context(func_code)),
+        previous_generated_code="// No previous generated test yet",
+        error_logs="// No previous errors", fix_examples="// No previous errors",
+    )
+
+
+def switch_backend(generator, backend: str, model_name: str, base_url: str = None):
+    """Point an existing generator at another backend, keeping its indexes and harness."""
+    generator.backend = backend
+    generator.model_name = model_name
+    generator.local_base_url = base_url
+    # The key may not have been read while the generator was local; raises if it is still unset
+    generator._load_environment()
+    generator.client = generator._initialize_client()
+    generator.router = generator._initialize_router([])
+
+
+def bench_backend(generator, label: str, func_files: list, build: bool = True) -> dict:
+    """
+    Generate tests for func_files on the generator's current backend. With build, a function
+    passes when its test compiles within the generator's retries (the normal pipeline); without,
+    when the first completion passes the static structure checks.
+    """
+    generator.ledger = UsageLedger(generator.base_dir / "usage" / f"bench_{label}.jsonl", generator.ledger.driver)
+    passed = 0
+    start = time.perf_counter()
+    for func_file in func_files:
+        generator.ledger.function = func_file.stem
+        if build:
+            ok = generator.generate_test_for_function(func_file)
+        else:
+            code = generator._query_model(static_prompt(generator, func_file), prefix=generator.shared_prefix)
+            ok = not code.startswith("// Error generating") and not PatchRepair.validate(code)
+        passed += bool(ok)
+    wall = time.perf_counter() - start
+    llm = [e for e in generator.ledger.events if e.kind == "llm" and e.ok]
+    decode = [e.completion_tokens / max(e.seconds - (e.ttft or 0.0), 1e-6) for e in llm]
+    totals = generator.ledger.totals()
+    return {
+        "backend": label,
+        "functions": len(func_files),
+        "pass_rate": passed / len(func_files) if func_files else 0.0,
+        "calls": len(llm),
+        "completion_tokens": int(totals["completion_tokens"]),
+        "tokens_per_s": totals["completion_tokens"] / totals["llm_seconds"] if totals["llm_seconds"] else 0.0,
+        "decode_tokens_per_s": statistics.median(decode) if decode else 0.0,
+        "ttft_p50": statistics.median([e.ttft for e in llm if e.ttft is not None] or [0.0]),
+        "wall_s": wall,
+    }
+
+
+def format_results(rows: list) -> str:
+    header = f"{'backend':<12} {'pass':>6} {'calls':>6} {'tokens':>8} {'tok/s':>7} {'decode/s':>9} {'ttft':>6} {'wall s':>8}"
+    lines = [header, "-" * len(header)]
+    for r in rows:
+        lines.append(f"{r['backend']:<12} {r['pass_rate']:>6.0%} {r['calls']:>6} {r['completion_tokens']:>8} "
+                     f"{r['tokens_per_s']:>7.1f} {r['decode_tokens_per_s']:>9.1f} {r['ttft_p50']:>6.2f} {r['wall_s']:>8.1f}")
+    return "\n".join(lines)
+
+
+if __name__ == "__main__":
+    from KunitGeneration.model_interface.llm_model import KUnitTestGenerator
+    from KunitGeneration.model_interface.local_backend import LocalServerConfig, LocalModelServer
+
+    parser = argparse.ArgumentParser(description="Compare the remote and a local CPU model on the sample functions.")
+    parser.add_argument("--base-dir", default="main_test_dir")
+    parser.add_argument("--source", default=None, help="driver source the functions come from")
+    parser.add_argument("--kernel-dir", default="/home/amd/linux")
+    parser.add_argument("--functions", type=int, default=5, help="number of sample functions")
+    parser.add_argument("--remote-model", default="qwen/qwen3-coder-480b-a35b-instruct")
+    parser.add_argument("--local-model", default="local", help="model name the local server reports")
+    parser.add_argument("--local-url", default=None)
+    parser.add_argument("--gguf", default=None, help="start llama-server with this model for the run")
+    parser.add_argument("--parallel", type=int, default=1, help="server slots batched together")
+    parser.add_argument("--threads", type=int, default=None)
+    parser.add_argument("--retries", type=int, default=1, help="attempts per function (1 = pass@1)")
+    parser.add_argument("--static", action="store_true", help="no kernel builds; static checks as pass criterion")
+    parser.add_argument("--skip-remote", action="store_true")
+    args = parser.parse_args()
+
+    base_dir = Path(args.base_dir)
+    func_files = sorted((base_dir / "test_functions").glob("*.c"))[:args.functions]
+    generator = KUnitTestGenerator(
+        main_test_dir=base_dir, model_name=args.local_model, temperature=0.2, max_retries=args.retries,
+        source_path=Path(args.source) if args.source else None, kernel_dir=Path(args.kernel_dir),
+        backend="local", local_base_url=args.local_url, speculative_k=args.parallel,
+    )
+    generator._build_shared_prefix()
+
+    server = None
+    if args.gguf:
+        config = LocalServerConfig(Path(args.gguf), parallel=args.parallel, threads=args.threads)
+        server = LocalModelServer(config, log_path=base_dir / "usage" / "llama_server.log").start()
+        switch_backend(generator, "local", args.local_model, args.local_url or config.base_url)
+    try:
+        rows = [bench_backend(generator, "local", func_files, build=not args.static)]
+        if not args.skip_remote:
+            switch_backend(generator, "nvidia", args.remote_model)
+            rows.append(bench_backend(generator, "remote", func_files, build=not args.static))
+    finally:
+        if server is not None:
+            server.stop()
+    print("\n" + format_results(rows))
@@ -1,17 +1,49 @@
 import os
-import subprocess
 import re
-import faiss
+import shutil
+import time
 from pathlib import Path
 from dotenv import load_dotenv
 from sentence_transformers import SentenceTransformer
 from openai import OpenAI
-from KunitGeneration.model_interface.prompts.unittest_kunit_prompts import kunit_generation_prompt
+from KunitGeneration.model_interface.prompts.unittest_kunit_prompts import (kunit_shared_prefix, kunit_function_prompt,
+                                                                            kunit_repair_prompt, kunit_mock_rules)
+from KunitGeneration.model_interface.provider_router import HedgedProviderRouter, ProviderEndpoint, make_endpoint
+from KunitGeneration.model_interface.harness_builder import DriverHarnessBuilder
+from KunitGeneration.model_interface.patch_repair import PatchRepair, PatchError
+from KunitGeneration.model_interface.fix_memory import FixMemory, signatures_from_log
+from KunitGeneration.model_interface.speculative_candidates import SpeculativeCandidateGenerator
+from KunitGeneration.model_interface.usage_ledger import UsageLedger, Budget, BudgetExceeded
+from KunitGeneration.model_interface.local_backend import make_local_endpoint
+from KunitGeneration.kernel_build.suite_amalgamation import SuiteAmalgamator
+from KunitGeneration.kernel_build.compile_autofix import (AutoFixEngine, parse_gcc_diagnostics, format_diagnostics,
+                                                          is_diagnostic_line, JSON_DIAGNOSTICS_FLAG)
+from KunitGeneration.kernel_build.kunit_runner import KunitRunner
+from KunitGeneration.kernel_build.suite_minimizer import SuiteMinimizer
+from KunitGeneration.kernel_build.runtime_profiler import RuntimeProfile
+from KunitGeneration.kernel_build.static_stubs import StaticStubDriver, STATIC_STUB_HEADER
+from KunitGeneration.kernel_build.kconfig_closure import (KconfigTree, ARCH_BASELINE, config_for_object,
+                                                           minimal_kunitconfig)
+from KunitGeneration.data_ingestion.symbol_index import KernelSymbolIndex
+from KunitGeneration.data_ingestion.dependency_slicer import SourceDependencySlicer
+from KunitGeneration.retrieval.lexical_index import IdentifierBM25Index
+from KunitGeneration.retrieval.hybrid_retriever import HybridRetriever
+from KunitGeneration.retrieval.vector_backends import make_backend
+from KunitGeneration.retrieval.dense_retriever import DenseRetriever, chunk_files
 
 class KUnitTestGenerator:
     """Generates KUnit tests using RAG + LLM and fixes compilation errors."""
 
-    def __init__(self, main_test_dir: Path, model_name: str, temperature: float, max_retries: int = 3):
+    def __init__(self, main_test_dir: Path, model_name: str, temperature: float, max_retries: int = 3,
+                 hedge_providers: list = None, source_path: Path = None, amalgamate: bool = False,
+                 repair_mode: bool = True, kernel_dir: Path = Path("/home/amd/linux"),
+                 vector_backend: str = "faiss", vector_quantization: str = "sq8", nprobe: int = 8,
+                 makefile_path: Path = None, kconfig_path: Path = None, config_file: Path = None,
+                 use_uml: bool = False, speculative_k: int = 1, speculative_compile: int = 2,
+                 minimal_kunitconfig: bool = False, minimize_suites: bool = False,
+                 profile_runtime: bool = False, budget: Budget = None, prices: dict = None,
+                 backend: str = "nvidia", local_base_url: str = None, json_diagnostics: bool = True,
+                 mock_mode: str = "define"):
         if not main_test_dir.is_dir():
             raise FileNotFoundError(f"The specified test directory does not exist: {main_test_dir}")
 
@@ -25,94 +57,202 @@ class KUnitTestGenerator:
             self.base_dir / "reference_testcases" / "kunit_test3.c",
         ]
         self.error_log_file = self.base_dir / "compilation_log" / "compile_error.txt"
+        self.source_path = Path(source_path) if source_path else None
+        self.harness = None
+        self.slicer = None
+        self.kernel_dir = Path(kernel_dir)
+        self.amalgamate = amalgamate
 
-        #Makefile paths
-        self.makefile_path = Path(makefile_path) if makefile_path else None
-        self.kconfig_path = Path(kconfig_path) if kconfig_path else None
-        self.config_file = Path(config_file) if config_file else None
-
+        #Makefile paths (default: the gpio subsystem the tests are copied into)
+        self.makefile_path = Path(makefile_path) if makefile_path else self.kernel_dir / "drivers" / "gpio" / "Makefile"
+        self.kconfig_path = Path(kconfig_path) if kconfig_path else self.kernel_dir / "drivers" / "gpio" / "Kconfig"
+        self.config_file = Path(config_file) if config_file else self.kernel_dir / "my_gpio.config"
+        self._default_config_file = self.config_file
+        # `kunit.py build` checks compilation; passing builds boot and execute in the background
+        # GCC diagnostics as JSON: typed file/line/column/fix-its instead of scraped caret text
+        self.runner = KunitRunner(self.kernel_dir, self.config_file, use_uml=use_uml,
+                                  json_diagnostics=json_diagnostics)
+        self.current_test_file = None     # generated test the build log's diagnostics are mapped to
+        # Build with the driver's Kconfig dependency closure instead of the hand-maintained config
+        self.minimal_kunitconfig = minimal_kunitconfig
+        self.driver_config = None
+        # "define": mocks are #defines before the driver include, one driver compile per mock set;
+        # "static_stub": tests include a KUNIT_STATIC_STUB_REDIRECT copy and swap functions at run time
+        if mock_mode not in ("define", "static_stub"):
+            raise ValueError(f"Unknown mock_mode '{mock_mode}'. Use 'define' or 'static_stub'.")
+        self.requested_mock_mode = mock_mode
+        self.mock_mode = mock_mode    # effective mode: "define" for a run on a kernel without the stub header
+        self.driver_include = None    # file tests include instead of the driver (its stubbed copy)
+        # Drop cases that add no line/branch coverage (gcov under UML) from passing suites
+        self.minimize_suites = minimize_suites
+        # Per-case timings of every exec, accumulated across runs into a slow-test report
+        self.profile = RuntimeProfile(self.base_dir / "profile" / "timings.jsonl") if profile_runtime else None
 
         # Model settings
         self.model_name = model_name
         self.temperature = temperature
         self.max_tokens = 8192
         self.max_retries = max_retries
+        # Retries ask for a diff against the previous test instead of a whole new file
+        self.repair_mode = repair_mode
+        self.repair_max_tokens = 2048
+        self.patcher = PatchRepair()
+        # Symbol -> header index of the kernel checkout, shared by auto-fix and prompts
+        self.symbol_index = self._load_symbol_index()
+        # Rule-based fixes for mechanical compile errors, tried before any LLM retry
+        self.autofix = AutoFixEngine(
+            header_resolver=self.symbol_index.header_for if self.symbol_index else None
+        )
+        self.max_autofix_rounds = 3
+        # Error signature -> fix diffs learned from earlier runs, retrieved as few-shot repair examples
+        self.fix_memory = FixMemory(self.base_dir / "fix_memory" / "fixes.jsonl")
+        self.fix_examples_k = 2
+        # K > 1: request K candidates per attempt and compile the best `speculative_compile` together
+        self.speculative_k = max(1, speculative_k)
+        self.speculative_compile = max(1, speculative_compile)
+        # Tokens, latency, build and boot seconds per call; budgets stop retries or the whole run
+        self.ledger = UsageLedger(self.base_dir / "usage" / "usage.jsonl",
+                                  self.source_path.stem if self.source_path else "", budget, prices)
 
-        # Environment + Client
+        # Environment + Client: "nvidia" (remote) or "local" (OpenAI-compatible server, e.g. llama.cpp on CPU)
+        if backend not in ("nvidia", "local"):
+            raise ValueError(f"Unknown backend '{backend}'. Use 'nvidia' or 'local'.")
+        self.backend = backend
+        self.local_base_url = local_base_url
         self._load_environment()
         self.client = self._initialize_client()
-        self.prompt_template = kunit_generation_prompt
+        self.router = self._initialize_router(hedge_providers or [])
+        self.speculative = (SpeculativeCandidateGenerator(self._query_model, self.speculative_k, self.temperature)
+                            if self.speculative_k > 1 else None)
+        self.prompt_template = kunit_function_prompt
+        self.shared_prefix = None     # byte-stable system message, formatted once per run
 
-        # RAG setup
-        self.vector_index = self.base_dir / "code_index.faiss"
-        self.vector_map = self.base_dir / "file_map.txt"
+        # RAG setup: "faiss" (quantized, mmap-opened) or "chroma", behind the same retriever
+        backend_options = {"quantization": vector_quantization, "nprobe": nprobe} if vector_backend == "faiss" else {}
+        self.vector_store = make_backend(vector_backend, self.base_dir, **backend_options)
         self.embed_model = SentenceTransformer("all-MiniLM-L6-v2")
-        self.index, self.file_map = self._load_or_build_index()
+        self.dense = self._load_or_build_index()
+        self.retriever = self._build_hybrid_retriever()
 
     def _load_environment(self):
         load_dotenv()
         self.api_key = os.environ.get("NVIDIA_API_KEY")
-        if not self.api_key:
+        if not self.api_key and self.backend == "nvidia":
             raise ValueError("NVIDIA_API_KEY environment variable not set.")
 
     def _initialize_client(self):
+        if self.backend == "local":
+            return None
         return OpenAI(base_url="https://integrate.api.nvidia.com/v1", api_key=self.api_key)
 
+    def _primary_endpoint(self) -> ProviderEndpoint:
+        if self.backend == "local":
+            return make_local_endpoint(self.model_name, self.local_base_url)
+        return ProviderEndpoint(name="nvidia", base_url="https://integrate.api.nvidia.com/v1",
+                                model_name=self.model_name, api_key=self.api_key, client=self.client)
+
+    def _initialize_router(self, hedge_providers: list):
+        """The backend stays primary; each (provider, model) pair is a hedge target in priority order."""
+        endpoints = [self._primary_endpoint()]
+        for provider, model in hedge_providers:
+            try:
+                endpoints.append(make_endpoint(provider, model))
+            except ValueError as e:
+                print(f"⚠️ Skipping hedge provider '{provider}': {e}")
+        return HedgedProviderRouter(endpoints, concurrency=self.speculative_k)
+
+    def _load_symbol_index(self):
+        if not (self.kernel_dir / "include").is_dir():
+            print(f"⚠️ No kernel headers under {self.kernel_dir}; include resolution uses the built-in table.")
+            return None
+        return KernelSymbolIndex.for_kernel(self.kernel_dir, self.base_dir / "symbol_index")
+
     # ---------------- RAG Functions ----------------
-    def _build_faiss_index(self):
+    def _build_vector_index(self, dense: DenseRetriever):
         code_dir = self.base_dir / "reference_testcases"
         files = list(code_dir.rglob("*.c"))
         if not files:
             print(f"⚠️ No .c files found under {code_dir}")
-            return None, []
-        print(f"📦 Building FAISS index from {len(files)} C source files...")
-        texts = [f.read_text(errors="ignore") for f in files]
-        embeddings = self.embed_model.encode(texts, show_progress_bar=True)
-        dim = embeddings.shape[1]
-        index = faiss.IndexFlatL2(dim)
-        index.add(embeddings)
-        faiss.write_index(index, str(self.vector_index))
-        self.vector_map.write_text("\n".join(str(p) for p in files))
-        return index, [str(p) for p in files]
-
-    def _load_or_build_index(self):
-        print("🔍 Loading embedding model and FAISS index...")
-        if not self.vector_index.exists() or not self.vector_map.exists():
-            return self._build_faiss_index()
-        index = faiss.read_index(str(self.vector_index))
-        file_map = self.vector_map.read_text().splitlines()
-        print(f"✅ Loaded FAISS index from {self.vector_index}")
-        return index, file_map
+            return dense
+        print(f"📦 Building {self.vector_store.name} index from {len(files)} C source files...")
+        # Whole files as chunks; FAISS goes quantized IVF once the corpus is large enough to train it
+        return dense.build(chunk_files(files, granularity="file"))
+
+    def _load_or_build_index(self) -> DenseRetriever:
+        print(f"🔍 Loading embedding model and {self.vector_store.name} index...")
+        dense = DenseRetriever(self.vector_store, self.embed_model)
+        if not self.vector_store.exists():
+            return self._build_vector_index(dense)
+        dense.load_or_build([])
+        report = self.vector_store.memory_report()
+        print(f"✅ Loaded {self.vector_store.name} index ({report['vectors']} vectors, "
+              f"{report['process_rss_mb']} MB process RSS)")
+        return dense
+
+    def _build_hybrid_retriever(self):
+        """Identifier/BM25 index over the same reference files, fused with dense hits."""
+        files = [doc_id.split("::")[0] for doc_id in self.dense.doc_ids]
+        lexical = IdentifierBM25Index.from_files([f for f in dict.fromkeys(files) if Path(f).exists()])
+        dense = self.dense.search_ids if self.dense.ready else None
+        return HybridRetriever(lexical, dense_search=dense)
 
     def _retrieve_context(self, query_text: str, top_k: int = 3):
-        if self.index is None:
-            return ["// Retrieval skipped (no FAISS index available)"]
-        query_emb = self.embed_model.encode([query_text])
-        distances, indices = self.index.search(query_emb, top_k)
+        if not self.dense.ready and len(self.retriever.lexical) == 0:
+            return ["// Retrieval skipped (no vector index available)"]
         results = []
-        for idx in indices[0]:
-            if idx < len(self.file_map):
-                p = Path(self.file_map[idx])
-                if p.exists():
-                    text = p.read_text(errors="ignore")
-                    results.append(f"// From {p}\n{text[:1500]}")
+        for hit in self.retriever.search(query_text, top_k):
+            p = Path(hit.doc_id)
+            if p.exists():
+                text = p.read_text(errors="ignore")
+                results.append(f"// From {p}\n{text[:1500]}")
         return results
 
     # ---------------- Model Query ----------------
-    def _query_model(self, prompt: str) -> str:
+    def _query_model(self, prompt: str, max_tokens: int = None, temperature: float = None, seed: int = None,
+                     prefix: str = None) -> str:
+        """prefix: a stable system message sent ahead of the prompt so providers can cache it."""
+        self.ledger.check()
+        start = time.perf_counter()
+        messages = [{"role": "user", "content": prompt}]
+        if prefix:
+            messages.insert(0, {"role": "system", "content": prefix})
         try:
-            completion = self.client.chat.completions.create(
-                model=self.model_name,
-                messages=[{"role": "user", "content": prompt}],
-                temperature=self.temperature,
-                max_tokens=self.max_tokens,
+            result = self.router.complete(
+                messages=messages,
+                temperature=self.temperature if temperature is None else temperature,
+                max_tokens=max_tokens or self.max_tokens,
+                seed=seed,
             )
-            response = completion.choices[0].message.content
+            self.ledger.record_llm(result, (prefix or "") + prompt)
+            if result.hedged:
+                print(f"🔀 Completion served by '{result.provider}' in {result.latency:.1f}s.")
+            response = result.text
             return response.replace("```c", "").replace("```", "").strip()
         except Exception as e:
+            self.ledger.record_failed_llm(time.perf_counter() - start)
             print(f"An error occurred while querying the model: {e}")
             return f"// Error generating response: {e}"
 
+    def _build_shared_prefix(self) -> str:
+        """Format the prefix shared by every function's request; call again only if the harness changes."""
+        source_name = self.source_path.name if self.source_path else "the driver"
+        if self.harness is not None:
+            harness_text = self.harness.harness_path.read_text(encoding="utf-8")
+            harness_section = f"## Shared Test Harness (`{self.harness.harness_name}`, already provided)\n{harness_text}"
+            harness_rules = (f"2. Start the file with #include \"{self.harness.harness_name}\" and nothing else before it; "
+                             f"do NOT re-declare includes, structs, macros, MMIO buffers or mocks it provides.")
+        else:
+            harness_section = "## Shared Test Harness\n// None: each test includes what it needs"
+            include_name = self.driver_include or source_name
+            harness_rules = f"2. Include all necessary kernel headers and the driver itself with #include \"{include_name}\"."
+        mock_rules = kunit_mock_rules[self.mock_mode].format(include_name=self.driver_include, source_name=source_name)
+        context = self._load_context_files()
+        reference_examples = "\n\n".join(context[f"sample_code{i}"] for i in (1, 2, 3))
+        self.shared_prefix = kunit_shared_prefix.format(source_name=source_name, harness_rules=harness_rules,
+                                                        harness_section=harness_section, mock_rules=mock_rules,
+                                                        reference_examples=reference_examples)
+        return self.shared_prefix
+
     def _load_context_files(self) -> dict:
         def safe_read(p: Path, fallback="// Missing file"):
             return p.read_text(encoding="utf-8") if p.exists() else fallback
@@ -124,14 +264,15 @@ class KUnitTestGenerator:
         }
 
 # ---------------- Kernel Build Integration ----------------
-    def _update_makefile(self, test_name: str):
+    def _update_makefile(self, test_name: str, objects: list = None):
+        """objects: several units built under the test's option (speculative candidates)."""
         makefile_path = self.makefile_path
         if not makefile_path.exists():
             print(f"⚠️  No Makefile found at '{makefile_path}' — skipping Makefile update.")
             return
     
         config_name = test_name.upper()
-        entry = f"obj-$(CONFIG_{config_name}) += {test_name}.o"
+        entry = f"obj-$(CONFIG_{config_name}) += {' '.join(f'{o}.o' for o in objects or [test_name])}"
     
         text = makefile_path.read_text(encoding="utf-8")
     
@@ -149,8 +290,8 @@ class KUnitTestGenerator:
             makefile_path.write_text(updated_text, encoding="utf-8")
             print("📝 Commented previous Makefile entries.")
     
-        # Add new entry only if not already present
-        if entry not in updated_text:
+        # Add new entry only if not already active (a commented-out copy does not count)
+        if entry not in updated_text.splitlines():
             with open(makefile_path, "a", encoding="utf-8") as f:
                 f.write("\n" + entry + "\n")
             print(f"🧩 Added to Makefile: {entry}")
@@ -167,7 +308,7 @@ class KUnitTestGenerator:
         kconfig_entry = (
             f"\nconfig {config_name}\n"
             f'\tbool "KUnit test for {test_name}"\n'
-            f"\tdepends on KUNIT\n"
+            f"\tdepends on KUNIT{' && ' + self.driver_config if self.driver_config else ''}\n"
             f"\tdefault n\n"
         )
     
@@ -217,66 +358,74 @@ class KUnitTestGenerator:
     
 
     def _compile_and_check(self) -> bool:
-        """Compile using the kernel's make command and check for errors."""
+        """Build (without booting) using `kunit.py build` and check for errors."""
         print("⚙️  Running kernel build to check for compilation errors...")
         
-        kernel_dir = Path("/home/amd/linux")
-        cmd = (
-            f"cp /home/amd/nithin/KunitGen/main_test_dir/generated_tests/*.c /home/amd/linux/drivers/gpio && "
-            f"./tools/testing/kunit/kunit.py run --kunitconfig=my_gpio.config --arch=x86_64 --raw_output > "
-            f"/home/amd/nithin/KunitGen/main_test_dir/compilation_log/compile_error.txt 2>&1"
-        )
-    
-        subprocess.run(cmd, shell=True, cwd=kernel_dir)
+        self._sync_generated_files()
+        start = time.perf_counter()
+        built = self.runner.build(self.error_log_file)
+        self.ledger.record_build(time.perf_counter() - start, built)
         # Check if log exists
         if not self.error_log_file.exists():
             print(f"❌ Log file not found: {self.error_log_file}")
             return False
+        if not built and self.runner.json_diagnostics and self._json_diagnostics_unsupported():
+            print(f"⚠️  The compiler rejects {JSON_DIAGNOSTICS_FLAG}; falling back to text diagnostics.")
+            self.runner.json_diagnostics = False
+            return self._compile_and_check()
+
+        error_blocks = self._extract_errors()
+        if error_blocks:
+            print(f"❌ Compilation failed. {len(error_blocks)} unique errors saved to 'clean_compile_errors.txt'.")
+            return False
+        if not built:
+            print(f"❌ kunit.py build failed without compiler errors; see '{self.error_log_file.name}'.")
+            return False
     
-        log_lines = self.error_log_file.read_text(encoding="utf-8").splitlines()
-    
+        print("✅ Compilation successful.")
+        return True
+
+    def _sync_generated_files(self):
+        for generated in list(self.output_dir.glob("*.c")) + list(self.output_dir.glob("*.h")):
+            shutil.copy2(generated, self.makefile_path.parent / generated.name)
+
+    def _json_diagnostics_unsupported(self) -> bool:
+        log = self.error_log_file.read_text(encoding="utf-8", errors="ignore")
+        return f"unrecognized command-line option '{JSON_DIAGNOSTICS_FLAG}'" in log.replace("‘", "'").replace("’", "'")
+
+    def _extract_errors(self) -> list:
+        """
+        Unique compiler errors of the build log, mapped to lines of the current generated test,
+        plus error lines from other tools (linker, modpost, make); saved to clean_compile_errors.txt.
+        """
+        log_text = self.error_log_file.read_text(encoding="utf-8", errors="ignore")
+        error_blocks = format_diagnostics(parse_gcc_diagnostics(log_text), self.current_test_file)
+
+        # Errors the compiler diagnostics do not cover, e.g. undefined symbols at link time
         seen = set()
-        error_blocks = []
-        i = 0
-        while i < len(log_lines):
-            line = log_lines[i]
-            # Match lines containing 'error:' or 'fatal error:'
-            if re.search(r"(error:|fatal error:)", line, re.IGNORECASE):
-                # Remove file path and line numbers
-                parts = line.split(':')
-                for j, p in enumerate(parts):
-                    if 'error' in p.lower():
-                        clean_error = ':'.join(parts[j:]).strip()
-                        break
-                else:
-                    clean_error = line.strip()
-    
-                if clean_error not in seen:
-                    seen.add(clean_error)
-                    # Capture next code line if it looks like code
-                    code_line = ""
-                    if i + 1 < len(log_lines):
-                        next_line = log_lines[i + 1]
-                        if re.match(r"\s+\S", next_line):
-                            code_line = next_line.rstrip()
-                    if code_line:
-                        error_blocks.append(f"{clean_error}\n{code_line}")
-                    else:
-                        error_blocks.append(clean_error)
-            i += 1
-    
+        for line in log_text.splitlines():
+            if is_diagnostic_line(line) or not re.search(r"(error:|fatal error:)", line, re.IGNORECASE):
+                continue
+            clean_error = line.strip()
+            if clean_error not in seen:
+                seen.add(clean_error)
+                error_blocks.append(clean_error)
+
         extracted_errors = "\n\n".join(error_blocks) if error_blocks else "No explicit error lines found."
-    
+
         # Save cleaned log
         extracted_log = self.error_log_file.parent / "clean_compile_errors.txt"
         extracted_log.write_text(extracted_errors, encoding="utf-8")
-    
-        if error_blocks:
-            print(f"❌ Compilation failed. {len(error_blocks)} unique errors saved to '{extracted_log.name}'.")
-            return False
-    
-        print("✅ Compilation successful.")
-        return True
+        return error_blocks
+
+    def _prompt_error_logs(self) -> str:
+        """Cleaned, test-mapped errors when the last build had any; the raw log otherwise."""
+        clean_log = self.error_log_file.parent / "clean_compile_errors.txt"
+        if clean_log.exists() and clean_log.stat().st_mtime >= self.error_log_file.stat().st_mtime:
+            text = clean_log.read_text(encoding="utf-8")
+            if text != "No explicit error lines found.":
+                return text
+        return self.error_log_file.read_text(encoding="utf-8", errors="ignore")
 
 
     # ---------------- Main Generation ----------------
@@ -284,51 +433,67 @@ class KUnitTestGenerator:
         func_code = func_file_path.read_text(encoding="utf-8")
         test_name = f"{func_file_path.stem}_kunit_test"
         out_file = self.output_dir / f"{test_name}.c"
+        self.current_test_file = out_file
     
         # Initial RAG-only context
-        context = self._load_context_files()
         retrieved_snippets = self._retrieve_context(func_code)
         retrieved_text = "\n\n".join(retrieved_snippets)
     
         previous_generated_code = "// No previous generated test yet"
-    
+        fix_examples = "// No previous errors"
+        failure = None    # (error signatures, code) of the last failed build
+
+        # Only the driver definitions this function actually depends on
+        dependency_slice = "// Driver source not available"
+        if self.slicer is not None:
+            dependency_slice = self.slicer.slice_for(func_file_path.stem) or "// No dependencies found"
+
+        # Deterministic include hints for every kernel symbol the function uses
+        header_hints = "// No kernel symbol index available"
+        if self.symbol_index is not None:
+            hints = self.symbol_index.headers_for_code(func_code)
+            header_hints = "\n".join(sorted({f"#include <{h}>" for h in hints.values()})) or "// None"
+
+        if self.shared_prefix is None:
+            self._build_shared_prefix()
+        self.ledger.function = func_file_path.stem
         for attempt in range(1, self.max_retries + 1):
+            exhausted = self.ledger.function_exhausted()
+            if exhausted:
+                print(f"💸 Giving up on {func_file_path.name}: {exhausted}.")
+                return False
             print(f"\n🔹 Generating test for {func_file_path.name} (Attempt {attempt}/{self.max_retries})...")
     
             # Load error logs (empty on first attempt)
             error_logs = (
-                self.error_log_file.read_text(encoding="utf-8")
+                self._prompt_error_logs()
                 if self.error_log_file.exists()
                 else "// No previous errors"
             )
     
-            prompt = f"""
-    You are an expert Linux kernel developer generating KUnit tests.
-    
-    ## Function to test
-    {func_code}
-    
-    ## Retrieved Similar Code
-    {retrieved_text}
-    
-    ## Previous Generated Test (for fixing failures)
-    {previous_generated_code}
-    
-    ## Previous Compilation Errors
-    {error_logs}
-    
-    Rules:
-    - Fix all compilation errors
-    - Include correct kernel headers
-    - Use kunit_kzalloc for allocations
-    - Use KUNIT_EXPECT_* macros
-    - Do not mock or modify the function under test
-    - Output ONLY a valid compilable KUnit C file
-    """
+            # Per-function suffix; the rules, harness and reference tests are in the shared prefix
+            prompt = self.prompt_template.format(
+                func_code=func_code,
+                dependency_slice=dependency_slice,
+                header_hints=header_hints,
+                retrieved_text=retrieved_text,
+                previous_generated_code=previous_generated_code,
+                error_logs=error_logs,
+                fix_examples=fix_examples,
+            )
     
-            # Generate new / corrected testcase
-            generated_test = self._query_model(prompt)
-            out_file.write_text(generated_test, encoding="utf-8")
+            # Generate new / corrected testcase; retries try a local patch first
+            generated_test = None
+            precompiled = None
+            if self.repair_mode and attempt > 1:
+                generated_test = self._repair_previous_test(previous_generated_code, fix_examples)
+            if generated_test is None and self.speculative is not None:
+                generated_test, precompiled = self._speculative_generate(prompt, func_file_path.stem, test_name)
+            if generated_test is None:
+                generated_test = self._query_model(prompt, prefix=self.shared_prefix)
+            # A candidate already compiled under this name keeps its mtime, so its object is reused
+            if not out_file.exists() or out_file.read_text(encoding="utf-8") != generated_test:
+                out_file.write_text(generated_test, encoding="utf-8")
             print(f"✅ Generated test file: {out_file}")
     
             # Update makefiles
@@ -338,34 +503,312 @@ class KUnitTestGenerator:
     
             # Try compiling
             print("⚙️  Running compile check...")
-            success = self._compile_and_check()
+            # No candidate compiled: the candidate build already left the best one's errors in the log
+            success = self._compile_and_check() if precompiled is not False else False
     
             if success:
+                self._remember_fix(failure, out_file, test_name)
+                self._queue_exec(test_name)
                 print(f"🎉 Test for {func_file_path.name} compiled successfully on attempt {attempt}.")
-                return
-    
+                return True
+    
+            # Mechanical errors are patched locally before spending another LLM round-trip
+            failure = self._failure_snapshot(out_file)
+            if self._autofix_and_recompile(out_file):
+                self._remember_fix(failure, out_file, test_name)
+                self._queue_exec(test_name)
+                print(f"🎉 Test for {func_file_path.name} compiled successfully after auto-fix on attempt {attempt}.")
+                return True
+
             # Save current generated version for the next retry
-            previous_generated_code = generated_test
+            previous_generated_code = out_file.read_text(encoding="utf-8")
+            failure = self._failure_snapshot(out_file)
+            fix_examples = self._fix_examples(failure[0])
             print(f"❌ Compilation failed. Regenerating with updated error logs + previous test...")
     
         print(f"\n❌ Failed to generate a compilable test for {func_file_path.name} after {self.max_retries} attempts.")
+        return False
+
+    def _autofix_and_recompile(self, test_file: Path) -> bool:
+        """Apply rule-based fixes until the test compiles or no rule matches anymore."""
+        for _ in range(self.max_autofix_rounds):
+            if not self.error_log_file.exists():
+                return False
+            diagnostics = parse_gcc_diagnostics(self.error_log_file.read_text(encoding="utf-8", errors="ignore"))
+            result = self.autofix.run(test_file, diagnostics)
+            if not result.changed:
+                return False
+            test_file.write_text(result.code, encoding="utf-8")
+            print(f"🔧 Auto-fixed {len(result.applied)} issues: {'; '.join(result.applied)}")
+            if self._compile_and_check():
+                return True
+        return False
+
+    def _speculative_generate(self, prompt: str, function_name: str, test_name: str):
+        """
+        Generate K candidates in parallel, rank them statically and compile the top few as
+        separate objects in one make run. Returns (code, True) for the best candidate that
+        compiled, (best ranked code, False) with its errors in the log if none did, or
+        (None, None) if no usable candidate came back. The top-ranked candidate is compiled
+        under the test's own name in the slot the next full build uses, so when it wins the
+        confirming build only links; other winners cost one more compile of the test unit.
+        """
+        candidates = self.speculative.generate(prompt, prefix=self.shared_prefix)
+        if not candidates:
+            return None, None
+        harness_name = self.harness.harness_name if self.harness else None
+        ranked = self.speculative.rank(candidates, function_name, harness_name)
+        for c in ranked:
+            notes = f" ({'; '.join(c.notes)})" if c.notes else ""
+            print(f"   🎲 candidate {c.index} T={c.temperature} seed={c.seed}: score {c.score:.1f}{notes}")
+
+        top = ranked[:self.speculative_compile]
+        names = [test_name] + [f"{test_name}__c{c.index}" for c in top[1:]]
+        for c, name in zip(top, names):
+            path = self.output_dir / f"{name}.c"
+            if not path.exists() or path.read_text(encoding="utf-8") != c.code:
+                path.write_text(c.code, encoding="utf-8")
+        self._update_makefile(test_name, objects=names)
+        self._update_kconfig(test_name)
+        self._update_test_config(test_name)
+        self._sync_generated_files()
+
+        rel_dir = self.makefile_path.parent.relative_to(self.kernel_dir)
+        objects = [f"{rel_dir}/{name}.o" for name in names]
+        print(f"⚙️  Compiling {len(objects)} candidates in one build...")
+        start = time.perf_counter()
+        compiled = self.runner.compile_objects(objects, self.error_log_file)
+        self.ledger.record_build(time.perf_counter() - start, any(compiled.values()))
+        log = self.error_log_file.read_text(encoding="utf-8", errors="ignore")
+        failing = {Path(d.file).name for d in parse_gcc_diagnostics(log) if d.severity in ("error", "fatal error")}
+
+        # The top candidate already sits under the real test name; only the extra ones go
+        for name in names[1:]:
+            (self.output_dir / f"{name}.c").unlink(missing_ok=True)
+            (self.makefile_path.parent / f"{name}.c").unlink(missing_ok=True)
+
+        for c, name, obj in zip(top, names, objects):
+            if compiled[obj] and f"{name}.c" not in failing:
+                print(f"🎯 Candidate {c.index} compiled; confirming with a full build (link).")
+                return c.code, True
+
+        # Keep only the best candidate's errors (it is built under the real test name) for repair and auto-fix
+        others = tuple(f"{n}.c" for n in names[1:])
+        kept = [l for l in log.splitlines() if not any(o in l for o in others)]
+        self.error_log_file.write_text("\n".join(kept) + "\n", encoding="utf-8")
+        self._extract_errors()
+        print(f"❌ None of the {len(top)} candidates compiled; continuing with candidate {top[0].index}.")
+        return top[0].code, False
+
+    def _derive_kunitconfig(self):
+        """Write the smallest kunitconfig that builds the driver and switch the build to it."""
+        if self.driver_config is None:
+            print(f"⚠️ No obj-$(CONFIG_...) line builds {self.source_path.stem}.o; keeping {self.config_file.name}.")
+            return
+        # The whole tree resolves defaults and arch options; the subsystem Kconfig alone lists them explicitly
+        top = self.kernel_dir / "Kconfig"
+        tree = KconfigTree(top, self.kernel_dir) if top.exists() else KconfigTree(self.kconfig_path)
+        arch = "um" if self.runner.exec_arch == "um" else "x86"
+        text = minimal_kunitconfig(tree, [self.driver_config], ARCH_BASELINE[arch])
+        path = self.base_dir / "kunitconfig" / f"{self.source_path.stem}.kunitconfig"
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(text, encoding="utf-8")
+        self.config_file = path
+        self.runner.kunitconfig = path
+        print(f"🧩 Minimal kunitconfig ({len(text.splitlines()) - 1} options) written to {path}")
+
+    def _queue_exec(self, test_name: str):
+        """Boot + run the build that just passed while the next function is generated and built."""
+        self.runner.exec_async(test_name, self.error_log_file.parent / f"exec_{test_name}.txt")
+
+    def _write_static_stubs(self):
+        """Instrument a copy of the driver for run-time mocking; tests include it instead of the driver."""
+        if not (self.kernel_dir / "include" / STATIC_STUB_HEADER).exists():
+            print(f"⚠️ This kernel has no <{STATIC_STUB_HEADER}>; falling back to #define mocks for this run.")
+            self.mock_mode = "define"
+            return
+        # The copy lives where the tests are built, so `#include "<stem>_stubbed.c"` resolves
+        stubs = StaticStubDriver(self.source_path, self.makefile_path.parent)
+        stubs.write()
+        self.driver_include = stubs.include_name
+        print(f"🪝 {len(stubs.functions)} driver functions stubbable at run time via {stubs.path}")
+
+    def _enable_printk_time(self):
+        """
+        Per-case durations come from printk timestamps in the raw KTAP output. The option goes
+        into a derived kunitconfig under base_dir, never into the user's own file.
+        """
+        if not self.config_file.exists():
+            return
+        cfg_text = self.config_file.read_text(encoding="utf-8")
+        if "CONFIG_PRINTK_TIME=y" in cfg_text:
+            return
+        derived_dir = self.base_dir / "kunitconfig"
+        path = (self.config_file if self.config_file.parent == derived_dir
+                else derived_dir / f"{self.config_file.stem}.profile.kunitconfig")
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(cfg_text.rstrip() + "\nCONFIG_PRINTK_TIME=y\n", encoding="utf-8")
+        self.config_file = path
+        self.runner.kunitconfig = path
+        print(f"🧩 Enabled CONFIG_PRINTK_TIME=y in {path} for per-case timings.")
+
+    def _write_runtime_report(self, results: list):
+        driver = self.source_path.stem if self.source_path else ""
+        timed = sum(self.profile.record(r.log_path, driver, r.name) for r in results if r.log_path.exists())
+        sources = {r.name: self.output_dir / f"{r.name}.c" for r in results}
+        report = self.base_dir / "profile" / "slow_tests.md"
+        flagged = self.profile.write_report(report, sources)
+        print(f"⏱️  Timed {timed} cases; {len(flagged)} slow or suspicious cases listed in {report}")
+
+    def _failure_snapshot(self, test_file: Path):
+        log = self.error_log_file.read_text(encoding="utf-8", errors="ignore") if self.error_log_file.exists() else ""
+        return signatures_from_log(log), test_file.read_text(encoding="utf-8")
+
+    def _remember_fix(self, failure, test_file: Path, test_name: str):
+        """Store the diff that took the last failing version to the compiling one."""
+        if failure is None:
+            return
+        signatures, failed_code = failure
+        if self.fix_memory.record(signatures, failed_code, test_file.read_text(encoding="utf-8"), test_name):
+            print(f"🧠 Remembered fix for {len(signatures)} error signatures ({len(self.fix_memory)} stored).")
+
+    def _fix_examples(self, signatures: list) -> str:
+        matches = self.fix_memory.lookup(signatures, k=self.fix_examples_k)
+        if matches:
+            print(f"🧠 Found {len(matches)} earlier fixes for similar errors.")
+        return FixMemory.format_examples(matches)
+
+    def _repair_previous_test(self, previous_code: str, fix_examples: str = ""):
+        """Ask for a diff against the failed test and apply it locally; None means regenerate."""
+        clean_log = self.error_log_file.parent / "clean_compile_errors.txt"
+        error_logs = clean_log.read_text(encoding="utf-8") if clean_log.exists() else "// No previous errors"
+        prompt = kunit_repair_prompt.format(previous_code=previous_code, error_logs=error_logs,
+                                            fix_examples=fix_examples or "// No similar errors fixed before")
+        response = self._query_model(prompt, max_tokens=self.repair_max_tokens, prefix=self.shared_prefix)
+        try:
+            patched = self.patcher.apply(previous_code, response)
+        except PatchError as e:
+            print(f"⚠️ Repair patch rejected ({e}); falling back to full regeneration.")
+            return None
+        print("🩹 Applied repair patch to the previous test.")
+        return patched
+
+    def _build_amalgamated_suite(self, passed: dict):
+        """Merge passing per-function tests into one unit so the driver is compiled once."""
+        harness_name = self.harness.harness_name if self.harness else None
+        amalgamator = SuiteAmalgamator(self.source_path, self.output_dir, harness_name, self.driver_include)
+        merged = amalgamator.amalgamate(passed)
+        if merged is None:
+            return False
+        # Only the merged unit stays in the build; the per-function copies are superseded
+        # so their suites do not register twice.
+        self._update_makefile(amalgamator.test_name)
+        self._update_kconfig(amalgamator.test_name)
+        self._update_test_config(amalgamator.test_name)
+        if self._compile_and_check():
+            self._queue_exec(amalgamator.test_name)
+            print(f"🎉 Amalgamated suite {merged.name} compiled successfully.")
+            return True
+        print(f"❌ Amalgamated suite {merged.name} failed to compile; per-function tests are unchanged.")
+        return False
 
     
             
-    def run(self):
+    def retarget(self, source_path: Path, functions_dir: Path = None, makefile_path: Path = None,
+                 kconfig_path: Path = None, config_file: Path = None):
+        """
+        Point a warm generator (models, indexes, client, build trees) at another driver so a
+        long-running service can reuse it; per-driver state is reset, shared state is kept.
+        """
+        self.source_path = Path(source_path) if source_path else None
+        self.functions_dir = Path(functions_dir) if functions_dir else self.base_dir / "test_functions"
+        if makefile_path:
+            self.makefile_path = Path(makefile_path)
+        if kconfig_path:
+            self.kconfig_path = Path(kconfig_path)
+        self.config_file = Path(config_file) if config_file else self._default_config_file
+        self.runner.kunitconfig = self.config_file
+        self.runner.results.clear()
+        self.harness = None
+        self.slicer = None
+        self.driver_config = None
+        self.driver_include = None
+        self.mock_mode = self.requested_mock_mode
+        self.shared_prefix = None
+        self.ledger = UsageLedger(self.ledger.log_path, self.source_path.stem if self.source_path else "",
+                                  self.ledger.budget, self.ledger.prices)
+
+    def run(self, only: set = None) -> dict:
+        """Generate tests for every extracted function, or only for the names in only; returns the passing tests."""
         print(f"--- Starting KUnit Test Generation in '{self.base_dir}' ---")
         self.output_dir.mkdir(parents=True, exist_ok=True)
         self.error_log_file.parent.mkdir(parents=True, exist_ok=True)
+        self.mock_mode = self.requested_mock_mode
 
         func_files = list(self.functions_dir.glob("*.c"))
+        if only is not None:
+            func_files = [f for f in func_files if f.stem in only]
+            print(f"🔁 Incremental run: {len(func_files)} of {len(only)} queued functions have extracted sources.")
+        if not func_files and only is not None:
+            print("✅ Nothing queued for regeneration.")
+            return {}
         if not func_files:
             print(f"❌ No C files found in '{self.functions_dir}'")
-            return
+            return {}
+
+        if self.source_path is not None:
+            self.slicer = SourceDependencySlicer(self.source_path.read_text(encoding="utf-8", errors="ignore"))
+            if self.makefile_path.exists():
+                self.driver_config = config_for_object(self.makefile_path, f"{self.source_path.stem}.o")
+            if self.minimal_kunitconfig:
+                self._derive_kunitconfig()
+            if self.mock_mode == "static_stub":
+                self._write_static_stubs()
+        if self.profile is not None:
+            self._enable_printk_time()
+        minimizer = SuiteMinimizer(self, self.source_path) if self.minimize_suites else None
+        if minimizer is not None:
+            minimizer.require_coverage()
+
+        passed, i = {}, 0
+        try:
+            # The harness and the shared prefix query the model too, so they count against the budget
+            if self.source_path is not None:
+                self.harness = DriverHarnessBuilder(self, self.source_path)
+                self.harness.build()
+            self._build_shared_prefix()
+            for i, func_file in enumerate(func_files):
+                self.ledger.check()
+                if self.generate_test_for_function(func_file):
+                    passed[func_file.stem] = self.output_dir / f"{func_file.stem}_kunit_test.c"
+        except BudgetExceeded as e:
+            skipped = [f.stem for f in func_files[i:]]
+            print(f"💸 Stopping: {e}. Not generated: {', '.join(skipped)}")
+        self.ledger.function = ""
+
+        if minimizer is not None and passed:
+            for test_file in passed.values():
+                minimizer.minimize(test_file.stem)
+
+        if self.amalgamate and self.source_path is not None and passed:
+            self._build_amalgamated_suite(passed)
 
-        for func_file in func_files:
-            self.generate_test_for_function(func_file)
+        results = self.runner.drain()
+        if results:
+            failing = [r.name for r in results if not r.ok]
+            print(f"\n🧪 Executed {len(results)} builds: {len(results) - len(failing)} passed"
+                  + (f", failing: {', '.join(failing)}" if failing else ""))
+            if self.profile is not None:
+                self._write_runtime_report(results)
+        for r in results:
+            self.ledger.record_boot(r.name.removesuffix("_kunit_test"), r.seconds, r.ok)
+        summary = self.ledger.summary()
+        self.ledger.log_path.parent.mkdir(parents=True, exist_ok=True)
+        (self.ledger.log_path.parent / f"summary_{self.ledger.run_id}.txt").write_text(summary + "\n", encoding="utf-8")
+        print(f"\n💰 Usage\n{summary}")
 
         print("\n--- ✅ All tests processed. ---")
+        return passed
 
 
 
@@ -0,0 +1,104 @@
+import os
+import shutil
+import subprocess
+import time
+import urllib.error
+import urllib.request
+from dataclasses import dataclass
+from pathlib import Path
+from KunitGeneration.model_interface.provider_router import ProviderEndpoint
+
+DEFAULT_LOCAL_URL = "http://127.0.0.1:8080/v1"
+
+
+@dataclass
+class LocalServerConfig:
+    """
+    A llama.cpp `llama-server` hosting a quantized (GGUF) code model on CPU. `parallel` is the
+    number of server slots decoded together with continuous batching; the generator sends that
+    many requests at once (speculative candidates), so both should usually match.
+    """
+    model_path: Path
+    host: str = "127.0.0.1"
+    port: int = 8080
+    threads: int = None             # default: all cores
+    parallel: int = 1
+    ctx_per_slot: int = 16384       # prompt + completion budget of one request
+    batch_size: int = 512           # logical prompt-processing batch
+    ubatch_size: int = 256          # physical batch
+    binary: str = "llama-server"
+
+    @property
+    def base_url(self) -> str:
+        return f"http://{self.host}:{self.port}/v1"
+
+    def command(self) -> list:
+        return [
+            self.binary, "-m", str(self.model_path), "--host", self.host, "--port", str(self.port),
+            "-t", str(self.threads or os.cpu_count()), "--parallel", str(self.parallel), "--cont-batching",
+            "-c", str(self.ctx_per_slot * self.parallel), "-b", str(self.batch_size), "-ub", str(self.ubatch_size),
+        ]
+
+
+class LocalModelServer:
+    """Starts and stops a local llama-server; usable as a context manager."""
+
+    def __init__(self, config: LocalServerConfig, log_path: Path = None, startup_timeout: float = 300.0):
+        self.config = config
+        self.log_path = Path(log_path) if log_path else None
+        self.startup_timeout = startup_timeout
+        self.proc = None
+
+    def healthy(self) -> bool:
+        url = f"http://{self.config.host}:{self.config.port}/health"
+        try:
+            with urllib.request.urlopen(url, timeout=2) as resp:
+                return resp.status == 200
+        except (urllib.error.URLError, OSError):
+            return False
+
+    def start(self):
+        if self.healthy():
+            print(f"♻️  Reusing the local model server at {self.config.base_url}")
+            return self
+        if shutil.which(self.config.binary) is None:
+            raise FileNotFoundError(f"{self.config.binary} not found on PATH; build llama.cpp or set binary.")
+        log = open(self.log_path, "w", encoding="utf-8") if self.log_path else subprocess.DEVNULL
+        print(f"🖥️  Starting {' '.join(self.config.command())}")
+        self.proc = subprocess.Popen(self.config.command(), stdout=log, stderr=subprocess.STDOUT)
+        deadline = time.time() + self.startup_timeout
+        # /health answers 503 while the model is still loading
+        while time.time() < deadline:
+            if self.proc.poll() is not None:
+                raise RuntimeError(f"llama-server exited with {self.proc.returncode} while loading the model")
+            if self.healthy():
+                print(f"✅ Local model server ready at {self.config.base_url}")
+                return self
+            time.sleep(1.0)
+        self.stop()
+        raise TimeoutError(f"llama-server did not become healthy within {self.startup_timeout:.0f}s")
+
+    def stop(self):
+        if self.proc is not None and self.proc.poll() is None:
+            self.proc.terminate()
+            try:
+                self.proc.wait(timeout=30)
+            except subprocess.TimeoutExpired:
+                self.proc.kill()
+        self.proc = None
+
+    def __enter__(self):
+        return self.start()
+
+    def __exit__(self, *exc):
+        self.stop()
+
+
+def make_local_endpoint(model_name: str = "local", base_url: str = None) -> ProviderEndpoint:
+    """
+    Endpoint for a local OpenAI-compatible server (llama.cpp, vLLM, Ollama...). The URL comes
+    from LOCAL_LLM_BASE_URL unless given; local servers need no key.
+    """
+    base_url = base_url or os.environ.get("LOCAL_LLM_BASE_URL", DEFAULT_LOCAL_URL)
+    return ProviderEndpoint(name="local", base_url=base_url, model_name=model_name,
+                            api_key_env="LOCAL_LLM_API_KEY")
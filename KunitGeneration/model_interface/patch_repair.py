@@ -0,0 +1,106 @@
+import re
+
+
+class PatchError(Exception):
+    """Raised when a model-produced patch does not apply to the previous test."""
+
+
+class PatchRepair:
+    """
+    Applies repair responses that are either a unified diff or SEARCH/REPLACE edit blocks
+    against the previously generated test, so retries only pay for the changed lines.
+    """
+
+    HUNK_HEADER = re.compile(r"^@@ -(\d+)(?:,(\d+))? \+(\d+)(?:,(\d+))? @@")
+    EDIT_BLOCK = re.compile(r"<<<<<<< SEARCH\n(.*?)\n?=======\n(.*?)\n?>>>>>>> REPLACE", re.DOTALL)
+
+    # ---------------- Unified diff ----------------
+    def _parse_hunks(self, diff_text: str) -> list:
+        hunks, current = [], None
+        for line in diff_text.splitlines():
+            header = self.HUNK_HEADER.match(line)
+            if header:
+                current = {"start": int(header.group(1)), "old": [], "new": []}
+                hunks.append(current)
+                continue
+            if current is None or line.startswith(("--- ", "+++ ", "\\")):
+                continue
+            tag, text = (line[0], line[1:]) if line else (" ", "")
+            if tag == " ":
+                current["old"].append(text)
+                current["new"].append(text)
+            elif tag == "-":
+                current["old"].append(text)
+            elif tag == "+":
+                current["new"].append(text)
+            else:
+                # Models often drop the leading space on context lines.
+                current["old"].append(line)
+                current["new"].append(line)
+        return hunks
+
+    @staticmethod
+    def _find_block(lines: list, block: list, hint: int) -> int:
+        """Locate block nearest to hint, exactly first and then ignoring whitespace."""
+        if not block:
+            return min(max(hint, 0), len(lines))
+        for normalize in (lambda s: s, lambda s: " ".join(s.split())):
+            target = [normalize(b) for b in block]
+            candidates = [
+                i for i in range(len(lines) - len(block) + 1)
+                if [normalize(l) for l in lines[i:i + len(block)]] == target
+            ]
+            if candidates:
+                return min(candidates, key=lambda i: abs(i - hint))
+        return -1
+
+    def apply_unified_diff(self, original: str, diff_text: str) -> str:
+        hunks = self._parse_hunks(diff_text)
+        if not hunks:
+            raise PatchError("no unified diff hunks found")
+        lines = original.splitlines()
+        offset = 0
+        for n, hunk in enumerate(hunks, start=1):
+            pos = self._find_block(lines, hunk["old"], hunk["start"] - 1 + offset)
+            if pos < 0:
+                raise PatchError(f"hunk {n} (@@ -{hunk['start']}) does not match the previous test")
+            lines[pos:pos + len(hunk["old"])] = hunk["new"]
+            offset += len(hunk["new"]) - len(hunk["old"])
+        return "\n".join(lines) + "\n"
+
+    # ---------------- SEARCH/REPLACE edits ----------------
+    def apply_edits(self, original: str, response: str) -> str:
+        blocks = self.EDIT_BLOCK.findall(response)
+        if not blocks:
+            raise PatchError("no SEARCH/REPLACE edit blocks found")
+        lines = original.splitlines()
+        for n, (search, replace) in enumerate(blocks, start=1):
+            pos = self._find_block(lines, search.splitlines(), 0)
+            if pos < 0:
+                raise PatchError(f"edit {n} SEARCH text not found in the previous test")
+            lines[pos:pos + len(search.splitlines())] = replace.splitlines()
+        return "\n".join(lines) + "\n"
+
+    # ---------------- Entry point ----------------
+    def apply(self, original: str, response: str) -> str:
+        """Apply whichever patch format the model answered with, then sanity-check the result."""
+        if "<<<<<<< SEARCH" in response:
+            patched = self.apply_edits(original, response)
+        else:
+            patched = self.apply_unified_diff(original, response)
+        problems = self.validate(patched)
+        if problems:
+            raise PatchError("; ".join(problems))
+        return patched
+
+    @staticmethod
+    def validate(code: str) -> list:
+        problems = []
+        stripped = re.sub(r'"(\\.|[^"\\])*"|//[^\n]*|/\*.*?\*/', "", code, flags=re.DOTALL)
+        if stripped.count("{") != stripped.count("}"):
+            problems.append("unbalanced braces after patching")
+        if stripped.count("(") != stripped.count(")"):
+            problems.append("unbalanced parentheses after patching")
+        if not re.search(r"\bkunit_test_suites?\s*\(", code):
+            problems.append("patched test no longer registers a kunit suite")
+        return problems
@@ -1,36 +1,123 @@
 
-kunit_generation_prompt = """
-You are an expert Linux kernel developer with deep experience in writing high-quality, coverage-focused KUnit tests.
+# Per-function generation is sent as two messages. The shared prefix holds everything that is
+# the same for every function of a run (rules, harness, reference tests) and is formatted once,
+# so its bytes never change and providers with prefix caching serve it from cache. Everything
+# that varies goes into the per-function suffix, most stable sections first.
+kunit_shared_prefix = """You are an expert Linux kernel developer with deep experience in writing high-quality, coverage-focused KUnit tests.
 
-Your task is to automatically generate a **complete, compilable KUnit test file** for the given C source file, using a reference source and an error log to guide the generation. The goal is to produce code that compiles without any errors.
+For each request you receive one function of `{source_name}` and work on a **complete, compilable KUnit test file** for it: either writing the whole file or, when the request asks for it, only the edits that fix a previous version.
 
-## Inputs
+## Critical Rules
+
+1. Fix every compilation error listed under "Previous Compilation Errors"; never repeat one.
+{harness_rules}
+3. Use pointers for opaque structs and allocate with `kunit_kzalloc(test, sizeof(*obj), GFP_KERNEL)`.
+4. Avoid modifying read-only or const members.
+5. Place all test cases in a single `static struct kunit_case` array.
+6. Define one `static struct kunit_suite` referencing this array with `.test_cases` and register it with `kunit_test_suite()`.
+7. Use `KUNIT_EXPECT_*` macros for assertions.
+8. Cover all branches, edge cases and error paths of the function.
+9. **Do NOT mock or modify the function under test**; {mock_rules}
+10. Answer ONLY in the format given under the request's "Output Format"; nothing else.
+
+{harness_section}
+
+## Reference KUnit Tests
+{reference_examples}
+"""
+
+# Rule 9 of the shared prefix / rule 3 of the harness prompt, per mocking mode: "define" redirects
+# calls with #define before the driver include (a compile per mock set), "static_stub" swaps
+# driver functions at run time through KUNIT_STATIC_STUB_REDIRECT in an instrumented copy.
+kunit_mock_rules = {
+    "define": "mock dependencies only if required.",
+    "static_stub": (
+        "mock dependencies only if required, and only at run time: `{include_name}` is `{source_name}` with "
+        "KUNIT_STATIC_STUB_REDIRECT in every function, so include <kunit/static_stub.h> and call "
+        "`kunit_activate_static_stub(test, real_function, fake_function)` (fake with the identical signature) "
+        "inside the test case. Never `#define` a function to a mock, even if a reference test does. "
+        "Kernel API calls cannot be stubbed; drive them through fake MMIO and fixtures instead."
+    ),
+}
+
+kunit_harness_mock_rules = {
+    "define": "Define dependency mocks with #define BEFORE the driver include, never for the functions of the driver itself.",
+    "static_stub": ("Do NOT define mocks or #define any function: tests replace driver functions at run time with "
+                    "kunit_activate_static_stub(); include <kunit/static_stub.h> for them."),
+}
+
+kunit_function_prompt = """## Function to test
+{func_code}
 
-1. Reference Source (`source_code`):
-{sample_code2}
+## Driver Definitions The Function Depends On (types, macros, globals, callee prototypes)
+{dependency_slice}
 
-2. Previous Compilation Errors (`error_logs`):
+## Headers Declaring The Kernel Symbols Used
+{header_hints}
+
+## Retrieved Similar Code
+{retrieved_text}
+
+## Previous Generated Test (for fixing failures)
+{previous_generated_code}
+
+## Previous Compilation Errors
 {error_logs}
 
-## Critical Rules
+## Fixes That Resolved Similar Errors Before
+{fix_examples}
+
+## Output Format
+
+Return ONLY the C source of the complete test file.
+"""
+
+kunit_harness_prompt = """
+You are an expert Linux kernel developer preparing a shared KUnit test harness.
+
+Write ONE C header, `{harness_name}`, that every per-function KUnit test for `{source_name}` will include.
+The per-function tests will only contain test cases and their suite; everything shared lives here.
+
+## Driver Source (`{source_name}`)
+{source_code}
+
+## Problems Found In The Previous Harness
+{error_logs}
+
+## Harness Rules
+
+1. Use an include guard named `{guard}`.
+2. Include `<kunit/test.h>` and every kernel header the driver's types and the tests need.
+3. {mock_rule}
+4. Never redefine kernel logging macros (dev_dbg, dev_warn, dev_err, pr_*, printk).
+5. Include the driver exactly once with `#include "{include_name}"`; do NOT re-declare any struct, enum or macro it defines.
+6. Provide a fake MMIO buffer plus a reset helper, and static inline fixtures that allocate and wire the driver's main structs with `kunit_kzalloc`.
+7. Do NOT define any `kunit_case`, `kunit_suite` or call `kunit_test_suite`.
+8. Output ONLY the header contents.
+"""
+
+kunit_repair_prompt = """
+You are an expert Linux kernel developer fixing a KUnit test that failed to compile.
+
+## Previous Generated Test
+{previous_code}
+
+## Compilation Errors
+{error_logs}
+
+## Fixes That Resolved Similar Errors Before
+{fix_examples}
+
+## Output Format
+
+Do NOT rewrite the file. Return ONLY the minimal changes, either as
+- a unified diff against the previous test (`@@ -start,count +start,count @@` hunks with 3 lines of context), or
+- one or more edit blocks of the form:
+<<<<<<< SEARCH
+exact lines copied from the previous test
+=======
+replacement lines
+>>>>>>> REPLACE
 
-1. Include all necessary kernel headers for structs, macros, and functions.
-2. Use pointers for opaque structs and allocate with `kunit_kzalloc(test, sizeof(*obj), GFP_KERNEL)`.
-3. Avoid modifying read-only or const members.
-4. Ensure all functions are declared or included via headers; do not call undeclared functions.
-5. Include required macros/constants via headers.
-6. Place all test cases in a single `static struct kunit_case` array.
-7. Define one `static struct kunit_suite` referencing this array with `.test_cases`.
-8. Register the suite with `kunit_test_suite(my_suite)`.
-9. Use `KUNIT_EXPECT_*` macros for assertions.
-10. Avoid duplicating any errors from `error_logs`.
-11. Hit the unhit branches such that include the source file obtain code coverage.
-12. **Do NOT mock the functions being tested**. You may mock **dependencies** (helper functions, hardware calls, or internal struct accessors) if required using #define and cannot change the source file.
-13. add #include "gpio-amdpt.c" for each testcase
-## Instructions
-
-- Analyze all functions in `source_code`.
-- Generate tests covering all branches, edge cases, and error paths.
-- Only mock dependencies if required; never mock the function under test.
-- Output only compilable KUnit C source code.
+Fix every compilation error. Do not mock or modify the function under test.
 """
@@ -0,0 +1,304 @@
+import os
+import time
+import threading
+from collections import deque
+from concurrent.futures import ThreadPoolExecutor, wait, FIRST_COMPLETED
+from dataclasses import dataclass, field
+from openai import OpenAI
+
+
+class CompletionCancelled(Exception):
+    """Raised inside a provider call once another provider has already won."""
+
+
+@dataclass
+class ProviderEndpoint:
+    """One OpenAI-compatible chat endpoint (NVIDIA, OpenRouter, Google GenAI, local stand-in...)."""
+    name: str
+    base_url: str
+    model_name: str
+    api_key_env: str = ""
+    api_key: str = ""
+    client: object = field(default=None, repr=False)
+    # Ask for the token usage chunk at the end of the stream; off for servers that reject it
+    include_usage: bool = True
+
+    def __post_init__(self):
+        if not self.api_key and self.api_key_env:
+            self.api_key = os.environ.get(self.api_key_env, "")
+        if self.client is None:
+            # Local stand-ins accept any key, the OpenAI client just refuses an empty one.
+            self.client = OpenAI(base_url=self.base_url, api_key=self.api_key or "not-needed")
+
+
+# Known providers whose keys live in .env; model names are provider specific.
+KNOWN_PROVIDERS = {
+    "nvidia": ("https://integrate.api.nvidia.com/v1", "NVIDIA_API_KEY"),
+    "openrouter": ("https://openrouter.ai/api/v1", "OPENROUTER_API_KEY"),
+    "genai": ("https://generativelanguage.googleapis.com/v1beta/openai/", "GENAI_API_KEY"),
+}
+
+
+def make_endpoint(provider: str, model_name: str) -> ProviderEndpoint:
+    """Build an endpoint for one of KNOWN_PROVIDERS, reading its key from the environment."""
+    if provider not in KNOWN_PROVIDERS:
+        raise ValueError(f"Unknown provider '{provider}'. Known: {', '.join(KNOWN_PROVIDERS)}")
+    base_url, key_env = KNOWN_PROVIDERS[provider]
+    if not os.environ.get(key_env):
+        raise ValueError(f"{key_env} environment variable not set.")
+    return ProviderEndpoint(name=provider, base_url=base_url, model_name=model_name, api_key_env=key_env)
+
+
+def cached_prompt_tokens(usage):
+    """Cached prompt tokens from a usage object; providers report them under different names."""
+    if usage is None:
+        return None
+    details = getattr(usage, "prompt_tokens_details", None)
+    cached = getattr(details, "cached_tokens", None) if details is not None else None
+    if cached is None:
+        # DeepSeek-style and Anthropic-style compatible endpoints
+        cached = getattr(usage, "prompt_cache_hit_tokens", None) or getattr(usage, "cache_read_input_tokens", None)
+    return cached
+
+
+@dataclass
+class RoutedCompletion:
+    text: str
+    provider: str
+    latency: float
+    hedged: bool
+    model: str = ""
+    prompt_tokens: int = None       # None when the provider sent no usage chunk
+    completion_tokens: int = None
+    cached_tokens: int = None       # prompt tokens served from the provider's prefix cache
+    ttft: float = None              # seconds until the first content token
+    first_token_at: float = field(default=None, repr=False)
+
+
+class LatencyTracker:
+    """Sliding window of successful completion latencies for one endpoint."""
+
+    def __init__(self, window: int = 50):
+        self.samples = deque(maxlen=window)
+        self._lock = threading.Lock()
+
+    def record(self, seconds: float):
+        with self._lock:
+            self.samples.append(seconds)
+
+    def percentile(self, pct: float):
+        with self._lock:
+            data = sorted(self.samples)
+        if not data:
+            return None
+        rank = min(len(data) - 1, max(0, int(round(pct / 100.0 * (len(data) - 1)))))
+        return data[rank]
+
+    def __len__(self):
+        return len(self.samples)
+
+
+class HedgedProviderRouter:
+    """
+    Sends a chat request to the primary endpoint and, if it has not answered by the
+    primary's observed latency percentile, hedges the same request to the next endpoint.
+    The first valid completion wins and the losers' open streams are closed from complete().
+    A loser still inside create() (no response headers yet) cannot be interrupted; it keeps
+    its worker thread until the server answers or request_timeout expires, and its stream is
+    closed as soon as it opens. A primary that fails outright is failed-over immediately.
+    """
+
+    def __init__(
+        self,
+        endpoints: list,
+        hedge_percentile: float = 95.0,
+        min_samples: int = 5,
+        initial_hedge_delay: float = 30.0,
+        window: int = 50,
+        concurrency: int = 1,
+        request_timeout: float = 300.0,
+    ):
+        if not endpoints:
+            raise ValueError("HedgedProviderRouter needs at least one endpoint.")
+        self.endpoints = endpoints
+        self.hedge_percentile = hedge_percentile
+        self.min_samples = min_samples
+        self.initial_hedge_delay = initial_hedge_delay
+        # Per-request HTTP timeout; also bounds how long a cancelled call can hold its thread
+        self.request_timeout = request_timeout
+        self.latency = {ep.name: LatencyTracker(window) for ep in endpoints}
+        # Each in-flight complete() may hold one call per endpoint; concurrency is how many
+        # complete() calls (e.g. speculative candidates) are expected to run at once.
+        self.executor = ThreadPoolExecutor(max_workers=2 * len(endpoints) * max(1, concurrency),
+                                           thread_name_prefix="llm-hedge")
+
+    # ---------------- Hedge policy ----------------
+    def hedge_delay(self, endpoint: ProviderEndpoint) -> float:
+        tracker = self.latency[endpoint.name]
+        if len(tracker) < self.min_samples:
+            return self.initial_hedge_delay
+        return tracker.percentile(self.hedge_percentile)
+
+    @staticmethod
+    def _is_valid(text) -> bool:
+        return bool(text and text.strip())
+
+    # ---------------- Single provider call ----------------
+    def _call(self, endpoint: ProviderEndpoint, messages: list, temperature: float,
+              max_tokens: int, cancel: threading.Event, seed: int = None, streams: list = None) -> RoutedCompletion:
+        start = time.perf_counter()
+        extra = {"seed": seed} if seed is not None else {}
+        if endpoint.include_usage:
+            extra["stream_options"] = {"include_usage": True}
+        stream = endpoint.client.chat.completions.create(
+            model=endpoint.model_name,
+            messages=messages,
+            temperature=temperature,
+            max_tokens=max_tokens,
+            stream=True,
+            timeout=self.request_timeout,
+            **extra,
+        )
+        if streams is not None:
+            # Lets complete() close this stream once another endpoint has won
+            streams.append(stream)
+        parts = []
+        usage = None
+        first_token_at = None
+        try:
+            if cancel.is_set():
+                raise CompletionCancelled(endpoint.name)
+            for chunk in stream:
+                if cancel.is_set():
+                    raise CompletionCancelled(endpoint.name)
+                if chunk.choices and chunk.choices[0].delta.content:
+                    if first_token_at is None:
+                        first_token_at = time.perf_counter()
+                    parts.append(chunk.choices[0].delta.content)
+                if getattr(chunk, "usage", None):
+                    usage = chunk.usage
+        finally:
+            # Closing the stream drops the HTTP connection, which is what cancels server side work.
+            stream.close()
+        latency = time.perf_counter() - start
+        text = "".join(parts)
+        if self._is_valid(text):
+            self.latency[endpoint.name].record(latency)
+        return RoutedCompletion(
+            text=text, provider=endpoint.name, latency=latency, hedged=False, model=endpoint.model_name,
+            prompt_tokens=usage.prompt_tokens if usage else None,
+            completion_tokens=usage.completion_tokens if usage else None,
+            cached_tokens=cached_prompt_tokens(usage),
+            ttft=first_token_at - start if first_token_at else None, first_token_at=first_token_at,
+        )
+
+    # ---------------- Routing ----------------
+    def complete(self, messages: list, temperature: float, max_tokens: int, seed: int = None) -> RoutedCompletion:
+        """Return the first valid completion across endpoints, hedging in priority order."""
+        start = time.perf_counter()
+        cancel = threading.Event()
+        streams = []
+        pending = {}
+        errors = []
+        next_idx = 0
+
+        def launch():
+            nonlocal next_idx
+            ep = self.endpoints[next_idx]
+            next_idx += 1
+            fut = self.executor.submit(self._call, ep, messages, temperature, max_tokens, cancel, seed, streams)
+            pending[fut] = ep
+            return ep
+
+        current = launch()
+        try:
+            while pending:
+                timeout = None
+                if next_idx < len(self.endpoints):
+                    timeout = self.hedge_delay(current)
+                done, _ = wait(pending, timeout=timeout, return_when=FIRST_COMPLETED)
+
+                if not done:
+                    # Primary is past its latency percentile: hedge to the next provider.
+                    current = launch()
+                    print(f"⏱️  Hedging request to '{current.name}' after {timeout:.1f}s.")
+                    continue
+
+                for fut in done:
+                    ep = pending.pop(fut)
+                    try:
+                        result = fut.result()
+                    except Exception as e:
+                        errors.append(f"{ep.name}: {e}")
+                        continue
+                    if self._is_valid(result.text):
+                        # Only a completion served by a fallback endpoint counts as hedged
+                        result.hedged = ep is not self.endpoints[0]
+                        result.latency = time.perf_counter() - start
+                        if result.first_token_at is not None:
+                            # As seen by the caller, i.e. including any hedge delay
+                            result.ttft = result.first_token_at - start
+                        return result
+                    errors.append(f"{ep.name}: empty completion")
+
+                # Everything in flight failed; fail over without waiting for the hedge delay.
+                if not pending and next_idx < len(self.endpoints):
+                    current = launch()
+        finally:
+            cancel.set()
+            for stream in list(streams):
+                try:
+                    stream.close()
+                except Exception:
+                    pass
+
+        raise RuntimeError("All providers failed: " + "; ".join(errors))
+
+    def close(self):
+        self.executor.shutdown(wait=False, cancel_futures=True)
+
+
+if __name__ == "__main__":
+    # Self-check with two local stand-in endpoints speaking the OpenAI streaming protocol:
+    # the primary stalls, the secondary answers, the router must return the secondary.
+    import json
+    from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+    def stand_in(reply: str, delay: float):
+        class Handler(BaseHTTPRequestHandler):
+            def log_message(self, *args):
+                pass
+
+            def do_POST(self):
+                self.rfile.read(int(self.headers.get("Content-Length", 0)))
+                time.sleep(delay)
+                self.send_response(200)
+                self.send_header("Content-Type", "text/event-stream")
+                self.end_headers()
+                for token in reply.split(" "):
+                    chunk = {"id": "x", "object": "chat.completion.chunk", "created": 0, "model": "stand-in",
+                             "choices": [{"index": 0, "delta": {"content": token + " "}, "finish_reason": None}]}
+                    self.wfile.write(f"data: {json.dumps(chunk)}\n\n".encode())
+                usage = {"id": "x", "object": "chat.completion.chunk", "created": 0, "model": "stand-in", "choices": [],
+                         "usage": {"prompt_tokens": 1, "completion_tokens": len(reply.split(" ")), "total_tokens": 3}}
+                self.wfile.write(f"data: {json.dumps(usage)}\n\n".encode())
+                self.wfile.write(b"data: [DONE]\n\n")
+
+        server = ThreadingHTTPServer(("127.0.0.1", 0), Handler)
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+        return server
+
+    slow = stand_in("from primary", delay=5.0)
+    fast = stand_in("from secondary", delay=0.1)
+    router = HedgedProviderRouter(
+        [
+            ProviderEndpoint("primary", f"http://127.0.0.1:{slow.server_port}/v1", "stand-in"),
+            ProviderEndpoint("secondary", f"http://127.0.0.1:{fast.server_port}/v1", "stand-in"),
+        ],
+        initial_hedge_delay=0.5,
+    )
+    result = router.complete([{"role": "user", "content": "hi"}], temperature=0.0, max_tokens=16)
+    print(f"✅ {result.provider} answered in {result.latency:.2f}s (hedged={result.hedged}, "
+          f"first token {result.ttft:.2f}s, {result.prompt_tokens}+{result.completion_tokens} tokens): {result.text.strip()}")
+    assert result.provider == "secondary" and result.hedged and result.completion_tokens == 2
+    router.close()
@@ -0,0 +1,84 @@
+import re
+from concurrent.futures import ThreadPoolExecutor
+from dataclasses import dataclass, field
+from KunitGeneration.model_interface.patch_repair import PatchRepair
+
+
+@dataclass
+class Candidate:
+    index: int
+    temperature: float
+    seed: int
+    code: str
+    score: float = 0.0
+    notes: list = field(default_factory=list)
+
+
+def candidate_settings(k: int, temperature: float, base_seed: int = 0, spread: float = 0.2) -> list:
+    """(temperature, seed) per candidate: the configured temperature first, then alternately above/below it."""
+    settings = []
+    for i in range(k):
+        step = (i + 1) // 2
+        offset = step * spread * (1 if i % 2 else -1)
+        settings.append((round(min(1.2, max(0.0, temperature + offset)), 2), base_seed + i))
+    return settings
+
+
+class SpeculativeCandidateGenerator:
+    """
+    Requests K completions of the same prompt in parallel with varied temperature and seed,
+    drops duplicates and obviously broken output, and ranks the rest with cheap static
+    heuristics so only the most promising few are compiled.
+    """
+
+    ASSERTION = re.compile(r"\bKUNIT_(?:EXPECT|ASSERT)_\w+\s*\(")
+    CASE_ARRAY = re.compile(r"\bstruct\s+kunit_case\s+\w+\s*\[\s*\]")
+    PROSE = re.compile(r"^(?:Here|This|The|Note|Explanation|Below)\b.*[^;{}]$", re.MULTILINE)
+
+    def __init__(self, query_fn, k: int = 4, temperature: float = 0.4, base_seed: int = 0):
+        self.query_fn = query_fn          # query_fn(prompt, temperature=..., seed=..., **kwargs) -> str
+        self.k = k
+        self.temperature = temperature
+        self.base_seed = base_seed
+        self.pool = ThreadPoolExecutor(max_workers=k, thread_name_prefix="speculative")
+
+    def generate(self, prompt: str, **kwargs) -> list:
+        """kwargs (e.g. a shared prompt prefix) are passed to every query unchanged."""
+        settings = candidate_settings(self.k, self.temperature, self.base_seed)
+        futures = [self.pool.submit(self.query_fn, prompt, temperature=t, seed=s, **kwargs) for t, s in settings]
+        candidates, seen = [], set()
+        for i, ((t, s), fut) in enumerate(zip(settings, futures)):
+            code = fut.result()
+            key = re.sub(r"\s+", " ", code).strip()
+            if not code or code.startswith("// Error generating") or key in seen:
+                continue
+            seen.add(key)
+            candidates.append(Candidate(i, t, s, code))
+        return candidates
+
+    def score(self, candidate: Candidate, function_name: str, harness_name: str = None) -> Candidate:
+        code, notes, score = candidate.code, [], 0.0
+        for problem in PatchRepair.validate(code):
+            score -= 10.0
+            notes.append(problem)
+        if not re.search(rf"\b{re.escape(function_name)}\s*\(", code):
+            score -= 5.0
+            notes.append(f"never calls {function_name}")
+        if self.CASE_ARRAY.search(code):
+            score += 2.0
+        else:
+            notes.append("no kunit_case array")
+        score += 0.3 * min(len(self.ASSERTION.findall(code)), 10)
+        if harness_name and not code.lstrip().startswith(f'#include "{harness_name}"'):
+            score -= 2.0
+            notes.append("does not start with the harness include")
+        if self.PROSE.search(code):
+            score -= 2.0
+            notes.append("prose left in the output")
+        candidate.score, candidate.notes = score, notes
+        return candidate
+
+    def rank(self, candidates: list, function_name: str, harness_name: str = None) -> list:
+        scored = [self.score(c, function_name, harness_name) for c in candidates]
+        # Ties go to the lower index, i.e. the configured temperature
+        return sorted(scored, key=lambda c: (-c.score, c.index))
@@ -0,0 +1,166 @@
+import json
+import threading
+import time
+from collections import defaultdict
+from dataclasses import dataclass, field, asdict
+from pathlib import Path
+
+
+class BudgetExceeded(Exception):
+    """Raised when the run-wide budget is spent; the run stops scheduling new work."""
+
+
+@dataclass
+class Budget:
+    """Hard caps; None means unlimited. Costs use the ledger's price table."""
+    run_tokens: int = None
+    run_cost_usd: float = None
+    run_llm_seconds: float = None
+    run_build_seconds: float = None
+    function_tokens: int = None
+    function_cost_usd: float = None
+
+
+@dataclass
+class UsageEvent:
+    kind: str                       # llm, build, boot
+    function: str
+    driver: str
+    seconds: float
+    ok: bool = True
+    provider: str = ""
+    model: str = ""
+    prompt_tokens: int = 0
+    completion_tokens: int = 0
+    cached_tokens: int = 0          # prompt tokens the provider served from its prefix cache
+    ttft: float = None
+    usage_estimated: bool = False   # tokens estimated from characters; provider sent no usage
+    cost_usd: float = 0.0
+    run_id: str = ""
+    ts: float = field(default_factory=time.time)
+
+
+def estimate_tokens(text: str) -> int:
+    """Rough token count for providers that do not report usage (about 4 characters per token)."""
+    return max(1, len(text) // 4) if text else 0
+
+
+class UsageLedger:
+    """
+    Per-call accounting of LLM tokens, time-to-first-token and latency, plus build and boot
+    seconds, attributed to the function being worked on. Every event is appended to a JSON-lines
+    log; totals per function, per driver and per run back the budget checks and the summary.
+    prices maps model name -> (USD per 1M prompt tokens, USD per 1M completion tokens).
+    """
+
+    def __init__(self, log_path: Path, driver: str = "", budget: Budget = None, prices: dict = None):
+        self.log_path = Path(log_path)
+        self.driver = driver
+        self.budget = budget or Budget()
+        self.prices = prices or {}
+        self.run_id = time.strftime("%Y%m%d-%H%M%S")
+        self.function = ""
+        self.events = []
+        self._lock = threading.Lock()
+
+    def _append(self, event: UsageEvent) -> UsageEvent:
+        with self._lock:
+            self.events.append(event)
+            self.log_path.parent.mkdir(parents=True, exist_ok=True)
+            with open(self.log_path, "a", encoding="utf-8") as f:
+                f.write(json.dumps(asdict(event)) + "\n")
+        return event
+
+    def cost(self, model: str, prompt_tokens: int, completion_tokens: int) -> float:
+        price_in, price_out = self.prices.get(model, (0.0, 0.0))
+        return (prompt_tokens * price_in + completion_tokens * price_out) / 1e6
+
+    # ---------------- Recording ----------------
+    def record_llm(self, completion, prompt: str = "") -> UsageEvent:
+        """Record one RoutedCompletion; tokens are estimated when the stream carried no usage."""
+        estimated = completion.prompt_tokens is None
+        prompt_tokens = estimate_tokens(prompt) if estimated else completion.prompt_tokens
+        completion_tokens = (estimate_tokens(completion.text) if completion.completion_tokens is None
+                             else completion.completion_tokens)
+        return self._append(UsageEvent(
+            "llm", self.function, self.driver, completion.latency, True, completion.provider, completion.model,
+            prompt_tokens, completion_tokens, completion.cached_tokens or 0, completion.ttft, estimated,
+            self.cost(completion.model, prompt_tokens, completion_tokens), self.run_id))
+
+    def record_failed_llm(self, seconds: float) -> UsageEvent:
+        return self._append(UsageEvent("llm", self.function, self.driver, seconds, False, run_id=self.run_id))
+
+    def record_build(self, seconds: float, ok: bool) -> UsageEvent:
+        return self._append(UsageEvent("build", self.function, self.driver, seconds, ok, run_id=self.run_id))
+
+    def record_boot(self, function: str, seconds: float, ok: bool) -> UsageEvent:
+        return self._append(UsageEvent("boot", function, self.driver, seconds, ok, run_id=self.run_id))
+
+    # ---------------- Totals / budgets ----------------
+    def totals(self, function: str = None) -> dict:
+        t = defaultdict(float)
+        with self._lock:
+            events = [e for e in self.events if function is None or e.function == function]
+        for e in events:
+            t[f"{e.kind}_calls"] += 1
+            t[f"{e.kind}_seconds"] += e.seconds
+            t["tokens"] += e.prompt_tokens + e.completion_tokens
+            t["prompt_tokens"] += e.prompt_tokens
+            t["completion_tokens"] += e.completion_tokens
+            t["cached_tokens"] += e.cached_tokens
+            t["cost_usd"] += e.cost_usd
+        return t
+
+    def run_exhausted(self):
+        """Reason the run-wide budget is spent, or None."""
+        t, b = self.totals(), self.budget
+        for spent, cap, label in ((t["tokens"], b.run_tokens, "tokens"),
+                                  (t["cost_usd"], b.run_cost_usd, "USD"),
+                                  (t["llm_seconds"], b.run_llm_seconds, "LLM seconds"),
+                                  (t["build_seconds"], b.run_build_seconds, "build seconds")):
+            if cap is not None and spent >= cap:
+                return f"run budget of {cap} {label} spent ({spent:.6g})"
+        return None
+
+    def function_exhausted(self, function: str = None):
+        """Reason the current (or given) function's budget is spent, or None."""
+        t, b = self.totals(function or self.function), self.budget
+        if b.function_tokens is not None and t["tokens"] >= b.function_tokens:
+            return f"function budget of {b.function_tokens} tokens spent ({int(t['tokens'])})"
+        if b.function_cost_usd is not None and t["cost_usd"] >= b.function_cost_usd:
+            return f"function budget of {b.function_cost_usd} USD spent ({t['cost_usd']:.4f})"
+        return None
+
+    def check(self):
+        reason = self.run_exhausted()
+        if reason:
+            raise BudgetExceeded(reason)
+
+    # ---------------- Reporting ----------------
+    def summary_rows(self) -> list:
+        """One row per function, then the driver and run totals."""
+        with self._lock:
+            functions = list(dict.fromkeys(e.function for e in self.events))
+        rows = [(f or "(shared: harness, suites)", self.totals(f)) for f in functions]
+        ttfts = [e.ttft for e in self.events if e.kind == "llm" and e.ttft is not None]
+        total = self.totals()
+        total["ttft_p50"] = sorted(ttfts)[len(ttfts) // 2] if ttfts else 0.0
+        rows.append((f"driver {self.driver or '?'}", total))
+        return rows
+
+    def summary(self) -> str:
+        header = (f"{'function':<36} {'calls':>5} {'prompt':>8} {'cached':>7} {'compl':>7} {'cost $':>8} "
+                  f"{'llm s':>7} {'build s':>8} {'boot s':>7}")
+        lines = [header, "-" * len(header)]
+        rows = self.summary_rows()
+        for name, t in rows:
+            cached = t["cached_tokens"] / t["prompt_tokens"] if t["prompt_tokens"] else 0.0
+            lines.append(f"{name[:36]:<36} {int(t['llm_calls']):>5} {int(t['prompt_tokens']):>8} {cached:>7.0%} "
+                         f"{int(t['completion_tokens']):>7} {t['cost_usd']:>8.4f} {t['llm_seconds']:>7.1f} "
+                         f"{t['build_seconds']:>8.1f} {t['boot_seconds']:>7.1f}")
+        estimated = sum(1 for e in self.events if e.usage_estimated)
+        if estimated:
+            lines.append(f"({estimated} calls without provider usage; their tokens are estimated)")
+        ttft = rows[-1][1]["ttft_p50"]
+        lines.append(f"run {self.run_id}: median time-to-first-token {ttft:.2f}s, log {self.log_path}")
+        return "\n".join(lines)
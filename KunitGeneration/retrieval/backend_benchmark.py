@@ -0,0 +1,77 @@
+import argparse
+import tempfile
+import time
+from pathlib import Path
+import numpy as np
+from KunitGeneration.retrieval.dense_retriever import DenseRetriever, chunk_files
+from KunitGeneration.retrieval.evaluation import load_queries
+from KunitGeneration.retrieval.vector_backends import VECTOR_BACKENDS, make_backend
+from KunitGeneration.retrieval.vector_store import resident_memory_mb
+
+
+def benchmark_backend(name: str, chunks: list, embed_model, queries: list, k: int,
+                      repeats: int = 20, options: dict = None) -> dict:
+    """Build one backend from the shared chunks in a scratch dir and measure it on the shared queries."""
+    with tempfile.TemporaryDirectory(prefix=f"kunit_{name}_") as scratch:
+        rss_before = resident_memory_mb()
+        retriever = DenseRetriever(make_backend(name, Path(scratch), **(options or {})), embed_model)
+        start = time.perf_counter()
+        retriever.build(chunks)
+        build_s = time.perf_counter() - start
+
+        hits, latencies = 0.0, []
+        for text, relevant in queries:
+            found = {Path(meta.get("file", doc_id)).name for doc_id, _, meta in retriever.search(text, k)}
+            hits += len(found & relevant) / len(relevant)
+        # Latency on a pre-encoded query so embedding cost does not drown out the store
+        encoded = [embed_model.encode([text])[0] for text, _ in queries]
+        for _ in range(repeats):
+            for query in encoded:
+                t = time.perf_counter()
+                retriever.backend.search(query, k)
+                latencies.append(1000.0 * (time.perf_counter() - t))
+
+        report = retriever.backend.memory_report()
+        return {
+            "backend": name,
+            "chunks": len(chunks),
+            "build_s": build_s,
+            "p50_ms": float(np.percentile(latencies, 50)),
+            "p99_ms": float(np.percentile(latencies, 99)),
+            "rss_delta_mb": resident_memory_mb() - rss_before,
+            "file_mb": report.get("file_mb", 0.0),
+            f"recall@{k}": hits / len(queries),
+        }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare vector backends on the same corpus and labelled queries.")
+    parser.add_argument("--base-dir", default="main_test_dir")
+    parser.add_argument("--queries", default="main_test_dir/retrieval_queries.json")
+    parser.add_argument("--backends", nargs="+", default=list(VECTOR_BACKENDS), choices=VECTOR_BACKENDS)
+    parser.add_argument("--granularity", default="file", choices=["file", "function"])
+    parser.add_argument("--k", type=int, default=3)
+    parser.add_argument("--repeats", type=int, default=20)
+    parser.add_argument("--quantization", default="flat", choices=["sq8", "pq", "flat"],
+                        help="FAISS index type; flat is exact search, Chroma always uses HNSW")
+    args = parser.parse_args()
+
+    from sentence_transformers import SentenceTransformer
+    base_dir = Path(args.base_dir)
+    files = sorted((base_dir / "reference_testcases").rglob("*.c"))
+    chunks = chunk_files(files, args.granularity)
+    queries = load_queries(Path(args.queries), base_dir)
+    embed_model = SentenceTransformer("all-MiniLM-L6-v2")
+    print(f"📊 {len(chunks)} {args.granularity} chunks from {len(files)} files, {len(queries)} queries\n")
+
+    options = {"faiss": {"quantization": args.quantization}}
+    rows = [benchmark_backend(name, chunks, embed_model, queries, args.k, args.repeats, options.get(name))
+            for name in args.backends]
+    columns = list(rows[0])
+    print("".join(f"{c:>14}" for c in columns))
+    for row in rows:
+        print("".join(f"{v:>14.3f}" if isinstance(v, float) else f"{v:>14}" for v in row.values()))
+
+
+if __name__ == "__main__":
+    main()
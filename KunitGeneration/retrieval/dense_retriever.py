@@ -0,0 +1,99 @@
+import contextlib
+import io
+from dataclasses import dataclass, field
+from pathlib import Path
+from KunitGeneration.data_ingestion.function_extraction import CFunctionExtractor
+from KunitGeneration.retrieval.vector_backends import VectorBackend
+
+
+@dataclass
+class Chunk:
+    doc_id: str
+    text: str
+    metadata: dict = field(default_factory=dict)
+
+
+def chunk_files(files: list, granularity: str = "file") -> list:
+    """
+    The one chunking both generators share. "file" keeps each reference file whole (id = path);
+    "function" splits it per function (id = path::name) and records the byte span so the
+    text can be recovered from metadata alone, whichever backend stored it.
+    """
+    if granularity not in ("file", "function"):
+        raise ValueError(f"Unknown granularity '{granularity}'. Use file or function.")
+    chunks = []
+    for f in files:
+        path = Path(f)
+        code = path.read_text(errors="ignore")
+        base = {"file": str(path), "subsystem": path.parent.name}
+        if granularity == "file":
+            chunks.append(Chunk(str(path), code, dict(base)))
+            continue
+        extractor = CFunctionExtractor(source_code=code) if code.strip() else None
+        if extractor is None:
+            continue
+        with contextlib.redirect_stdout(io.StringIO()):
+            extractor.extract_functions()
+        cursor = 0
+        for func in extractor.functions:
+            start = code.find(func["code"], cursor)
+            if start < 0:
+                continue
+            cursor = start + len(func["code"])
+            chunks.append(Chunk(f"{path}::{func['name']}", func["code"],
+                                {**base, "function": func["name"], "start": start, "end": cursor}))
+    return chunks
+
+
+def chunk_text(doc_id: str, metadata: dict) -> str:
+    """Re-read a chunk's text from disk using the metadata written by chunk_files()."""
+    path = Path(metadata.get("file") or doc_id.split("::")[0])
+    if not path.exists():
+        return ""
+    text = path.read_text(errors="ignore")
+    if "start" in metadata:
+        return text[metadata["start"]:metadata["end"]]
+    return text
+
+
+class DenseRetriever:
+    """Embeds chunks and queries with one model and stores/searches them through any VectorBackend."""
+
+    def __init__(self, backend: VectorBackend, embed_model, normalize: bool = False):
+        self.backend = backend
+        self.embed_model = embed_model
+        self.normalize = normalize
+        self.ready = False
+
+    def _encode(self, texts: list, progress: bool = False):
+        return self.embed_model.encode(texts, normalize_embeddings=self.normalize, show_progress_bar=progress)
+
+    def build(self, chunks: list):
+        if not chunks:
+            self.ready = False
+            return self
+        embeddings = self._encode([c.text for c in chunks], progress=True)
+        self.backend.build(embeddings, [c.doc_id for c in chunks], [c.metadata for c in chunks])
+        self.ready = True
+        return self
+
+    def load_or_build(self, files: list, granularity: str = "file"):
+        if self.backend.exists():
+            self.backend.open()
+            self.ready = True
+            return self
+        return self.build(chunk_files(files, granularity))
+
+    @property
+    def doc_ids(self) -> list:
+        return self.backend.doc_ids if self.ready else []
+
+    def search(self, query: str, k: int, where: dict = None) -> list:
+        """[(doc_id, similarity, metadata)] best first."""
+        if not self.ready:
+            return []
+        return self.backend.search(self._encode([query])[0], k, where)
+
+    def search_ids(self, query: str, k: int) -> list:
+        """[(doc_id, similarity)], the shape HybridRetriever expects from a dense search."""
+        return [(doc_id, score) for doc_id, score, _ in self.search(query, k)]
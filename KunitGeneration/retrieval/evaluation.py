@@ -0,0 +1,72 @@
+import argparse
+import json
+import time
+from pathlib import Path
+from KunitGeneration.retrieval.lexical_index import IdentifierBM25Index
+from KunitGeneration.retrieval.hybrid_retriever import HybridRetriever
+
+
+def load_queries(query_file: Path, base_dir: Path) -> list:
+    """Labelled queries: {"query" | "query_file", "relevant": [file names]}."""
+    queries = []
+    for entry in json.loads(Path(query_file).read_text(encoding="utf-8")):
+        text = entry.get("query") or (base_dir / entry["query_file"]).read_text(errors="ignore")
+        queries.append((text, set(entry["relevant"])))
+    return queries
+
+
+def recall_at_k(retrieve, queries: list, k: int) -> tuple:
+    """retrieve(query, k) -> [doc_id]; relevance is matched on file name. Returns (recall, mean ms)."""
+    hits, elapsed = 0.0, 0.0
+    for text, relevant in queries:
+        start = time.perf_counter()
+        found = {Path(d).name for d in retrieve(text, k)}
+        elapsed += time.perf_counter() - start
+        hits += len(found & relevant) / len(relevant)
+    return hits / len(queries), 1000.0 * elapsed / len(queries)
+
+
+def dense_search_fn(files: list):
+    """Dense search over whole files, matching the generator's FAISS setup."""
+    import faiss
+    from sentence_transformers import SentenceTransformer
+    model = SentenceTransformer("all-MiniLM-L6-v2")
+    embeddings = model.encode([Path(f).read_text(errors="ignore") for f in files])
+    index = faiss.IndexFlatL2(embeddings.shape[1])
+    index.add(embeddings)
+
+    def search(query: str, k: int):
+        distances, indices = index.search(model.encode([query]), min(k, len(files)))
+        return [(str(files[i]), -float(d)) for d, i in zip(distances[0], indices[0]) if i >= 0]
+    return search
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Report retrieval recall@k on a labelled query set.")
+    parser.add_argument("--base-dir", default="main_test_dir")
+    parser.add_argument("--queries", default="main_test_dir/retrieval_queries.json")
+    parser.add_argument("--k", type=int, default=1)
+    parser.add_argument("--dense", action="store_true", help="also evaluate dense and hybrid retrieval")
+    parser.add_argument("--budget-ms", type=float, default=250.0)
+    args = parser.parse_args()
+
+    base_dir = Path(args.base_dir)
+    files = sorted((base_dir / "reference_testcases").rglob("*.c"))
+    queries = load_queries(Path(args.queries), base_dir)
+    lexical = IdentifierBM25Index.from_files(files)
+
+    dense = dense_search_fn(files) if args.dense else None
+    hybrid = HybridRetriever(lexical, dense_search=dense, budget_ms=args.budget_ms)
+    systems = {"lexical": lambda q, k: [d for d, _ in lexical.search(q, k)]}
+    if dense:
+        systems["dense"] = lambda q, k: [d for d, _ in dense(q, k)]
+    systems["hybrid"] = lambda q, k: [d.doc_id for d in hybrid.search(q, k)]
+
+    print(f"{'system':<10}{'recall@' + str(args.k):>12}{'ms/query':>12}")
+    for name, retrieve in systems.items():
+        recall, ms = recall_at_k(retrieve, queries, args.k)
+        print(f"{name:<10}{recall:>12.3f}{ms:>12.2f}")
+
+
+if __name__ == "__main__":
+    main()
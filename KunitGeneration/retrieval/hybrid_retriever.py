@@ -0,0 +1,76 @@
+import re
+import time
+from concurrent.futures import ThreadPoolExecutor, TimeoutError as FutureTimeout
+from dataclasses import dataclass, field
+from KunitGeneration.retrieval.lexical_index import IdentifierBM25Index, tokenize
+
+
+@dataclass
+class RetrievedDoc:
+    doc_id: str
+    score: float
+    sources: list = field(default_factory=list)
+
+
+class HybridRetriever:
+    """
+    Fuses identifier/BM25 hits with dense hits by reciprocal rank fusion, then reranks by
+    exact identifier overlap with the query. The cheap lexical path always runs; the dense
+    path only contributes if it answers within the latency budget. When the query is a
+    function definition, documents whose identifiers embed that function's name (test
+    cases are named after what they test) get an extra boost.
+    """
+
+    FOCUS = re.compile(r"^\s*(?:static\s+)?(?:inline\s+)?[\w\s\*]+?\b(\w+)\s*\([^)]*\)\s*\{")
+
+    def __init__(self, lexical: IdentifierBM25Index, dense_search=None, rrf_k: int = 60,
+                 candidate_k: int = 20, budget_ms: float = 250.0, overlap_weight: float = 0.5,
+                 focus_weight: float = 1.0):
+        self.lexical = lexical
+        self.dense_search = dense_search      # callable(query, k) -> [(doc_id, similarity)]
+        self.rrf_k = rrf_k
+        self.candidate_k = candidate_k
+        self.budget_ms = budget_ms
+        self.overlap_weight = overlap_weight
+        self.focus_weight = focus_weight
+        self._dense_pool = ThreadPoolExecutor(max_workers=1, thread_name_prefix="dense-retrieval")
+
+    def _rrf(self, ranked_lists: dict) -> dict:
+        fused = {}
+        for source, hits in ranked_lists.items():
+            for rank, (doc_id, _) in enumerate(hits, start=1):
+                doc = fused.setdefault(doc_id, RetrievedDoc(doc_id, 0.0))
+                doc.score += 1.0 / (self.rrf_k + rank)
+                doc.sources.append(source)
+        return fused
+
+    def _identifier_overlap(self, query_idents: set, doc_id: str) -> float:
+        """IDF-weighted share of the query's exact identifiers that occur in the document."""
+        if not query_idents:
+            return 0.0
+        doc_idents = self.lexical.identifiers_of(doc_id)
+        total = sum(self.lexical.idf(t) for t in query_idents)
+        hit = sum(self.lexical.idf(t) for t in query_idents & doc_idents)
+        return hit / total if total else 0.0
+
+    def search(self, query: str, k: int = 3) -> list:
+        start = time.perf_counter()
+        dense_future = self._dense_pool.submit(self.dense_search, query, self.candidate_k) if self.dense_search else None
+
+        ranked = {"lexical": self.lexical.search(query, self.candidate_k)}
+        if dense_future is not None:
+            remaining = self.budget_ms / 1000.0 - (time.perf_counter() - start)
+            try:
+                ranked["dense"] = dense_future.result(timeout=max(remaining, 0.0))
+            except FutureTimeout:
+                print(f"⏱️  Dense retrieval exceeded {self.budget_ms:.0f} ms budget; using lexical hits only.")
+
+        fused = self._rrf(ranked)
+        query_idents = {t for t in tokenize(query) if not t.startswith("~")}
+        focus = self.FOCUS.match(query)
+        max_rrf = 2.0 / (self.rrf_k + 1)
+        for doc in fused.values():
+            doc.score = doc.score / max_rrf + self.overlap_weight * self._identifier_overlap(query_idents, doc.doc_id)
+            if focus and any(focus.group(1) in ident for ident in self.lexical.identifiers_of(doc.doc_id)):
+                doc.score += self.focus_weight
+        return sorted(fused.values(), key=lambda d: d.score, reverse=True)[:k]
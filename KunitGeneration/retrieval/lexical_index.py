@@ -0,0 +1,103 @@
+import json
+import math
+import re
+from collections import Counter, defaultdict
+from pathlib import Path
+
+IDENTIFIER = re.compile(r"\b[A-Za-z_]\w{2,}\b")
+STOP_WORDS = {
+    "static", "struct", "const", "void", "int", "unsigned", "long", "char", "return", "include", "define",
+    "kunit", "test", "for", "while", "sizeof", "NULL", "true", "false", "u32", "u64", "u8", "u16",
+}
+
+
+def tokenize(text: str) -> list:
+    """Whole identifiers (exact API names) plus their underscore-separated parts."""
+    tokens = []
+    for ident in IDENTIFIER.findall(text):
+        if ident in STOP_WORDS:
+            continue
+        tokens.append(ident)
+        parts = [p.lower() for p in ident.split("_") if len(p) > 2]
+        if len(parts) > 1:
+            tokens += [f"~{p}" for p in parts if p not in STOP_WORDS]
+    return tokens
+
+
+class IdentifierBM25Index:
+    """Inverted identifier index with BM25 scoring over the reference corpus."""
+
+    def __init__(self, k1: float = 1.2, b: float = 0.75):
+        self.k1 = k1
+        self.b = b
+        self.doc_ids = []
+        self.doc_lookup = {}                  # doc_id -> position
+        self.doc_lengths = []
+        self.doc_identifiers = []             # exact identifiers per document, for reranking
+        self.postings = defaultdict(dict)    # token -> {doc index: term frequency}
+        self.avg_length = 0.0
+
+    @classmethod
+    def from_files(cls, files: list):
+        index = cls()
+        for f in files:
+            index.add(str(f), Path(f).read_text(errors="ignore"))
+        return index
+
+    def add(self, doc_id: str, text: str):
+        doc = len(self.doc_ids)
+        counts = Counter(tokenize(text))
+        self.doc_ids.append(doc_id)
+        self.doc_lookup[doc_id] = doc
+        self.doc_lengths.append(sum(counts.values()))
+        self.doc_identifiers.append({t for t in counts if not t.startswith("~")})
+        for token, tf in counts.items():
+            self.postings[token][doc] = tf
+        self.avg_length = sum(self.doc_lengths) / len(self.doc_lengths)
+
+    def __len__(self):
+        return len(self.doc_ids)
+
+    def idf(self, token: str) -> float:
+        df = len(self.postings.get(token, ()))
+        return math.log(1 + (len(self.doc_ids) - df + 0.5) / (df + 0.5))
+
+    def search(self, query: str, k: int = 10) -> list:
+        """Return [(doc_id, score)] best first."""
+        scores = defaultdict(float)
+        for token, qtf in Counter(tokenize(query)).items():
+            posting = self.postings.get(token)
+            if not posting:
+                continue
+            idf = self.idf(token)
+            for doc, tf in posting.items():
+                norm = tf + self.k1 * (1 - self.b + self.b * self.doc_lengths[doc] / (self.avg_length or 1))
+                scores[doc] += idf * tf * (self.k1 + 1) / norm
+        best = sorted(scores.items(), key=lambda kv: kv[1], reverse=True)[:k]
+        return [(self.doc_ids[doc], score) for doc, score in best]
+
+    def identifiers_of(self, doc_id: str) -> set:
+        doc = self.doc_lookup.get(doc_id)
+        return self.doc_identifiers[doc] if doc is not None else set()
+
+    # ---------------- Persistence ----------------
+    def save(self, path: Path):
+        Path(path).write_text(json.dumps({
+            "k1": self.k1, "b": self.b, "doc_ids": self.doc_ids, "doc_lengths": self.doc_lengths,
+            "postings": {t: {str(d): tf for d, tf in p.items()} for t, p in self.postings.items()},
+        }), encoding="utf-8")
+
+    @classmethod
+    def load(cls, path: Path):
+        data = json.loads(Path(path).read_text(encoding="utf-8"))
+        index = cls(data["k1"], data["b"])
+        index.doc_ids, index.doc_lengths = data["doc_ids"], data["doc_lengths"]
+        index.doc_lookup = {d: i for i, d in enumerate(index.doc_ids)}
+        index.doc_identifiers = [set() for _ in index.doc_ids]
+        for token, posting in data["postings"].items():
+            index.postings[token] = {int(d): tf for d, tf in posting.items()}
+            if not token.startswith("~"):
+                for d in index.postings[token]:
+                    index.doc_identifiers[d].add(token)
+        index.avg_length = sum(index.doc_lengths) / max(len(index.doc_lengths), 1)
+        return index
@@ -0,0 +1,204 @@
+import json
+from pathlib import Path
+from KunitGeneration.retrieval.vector_store import QuantizedVectorStore, resident_memory_mb
+
+
+def _matches(metadata: dict, where: dict) -> bool:
+    return all(metadata.get(key) == value for key, value in where.items())
+
+
+class VectorBackend:
+    """
+    Storage/search interface every dense retrieval backend implements. Ids are strings,
+    metadata is a flat dict per id, and search returns [(doc_id, similarity, metadata)]
+    best first, where a larger similarity is better regardless of the backend's metric.
+    """
+    name = "backend"
+
+    def exists(self) -> bool:
+        raise NotImplementedError("Subclasses must implement exists().")
+
+    def build(self, embeddings, doc_ids: list, metadatas: list = None):
+        raise NotImplementedError("Subclasses must implement build().")
+
+    def build_streaming(self, batches):
+        """Build from an iterable of (embeddings, doc_ids) batches; backends that can add incrementally override this."""
+        import numpy as np
+        embeddings, doc_ids = [], []
+        for batch_embeddings, batch_ids in batches:
+            embeddings.append(batch_embeddings)
+            doc_ids += list(batch_ids)
+        return self.build(np.vstack(embeddings), doc_ids)
+
+    def open(self):
+        raise NotImplementedError("Subclasses must implement open().")
+
+    def search(self, query_embedding, k: int, where: dict = None) -> list:
+        raise NotImplementedError("Subclasses must implement search().")
+
+    @property
+    def doc_ids(self) -> list:
+        raise NotImplementedError("Subclasses must implement doc_ids.")
+
+    def memory_report(self) -> dict:
+        return {"backend": self.name, "vectors": len(self.doc_ids), "process_rss_mb": round(resident_memory_mb(), 1)}
+
+
+class FaissBackend(VectorBackend):
+    """QuantizedVectorStore plus a JSON-lines metadata sidecar; `where` filters are applied after search."""
+    name = "faiss"
+    OVERSAMPLE = 4
+
+    def __init__(self, index_path: Path, map_path: Path, quantization: str = "sq8", nprobe: int = 8, nlist: int = None):
+        self.store = QuantizedVectorStore(index_path, map_path, quantization=quantization, nlist=nlist, nprobe=nprobe)
+        self.meta_path = Path(map_path).with_suffix(".meta.jsonl")
+        self.metadatas = []
+
+    def exists(self) -> bool:
+        return self.store.index_path.exists() and self.store.map_path.exists()
+
+    def build(self, embeddings, doc_ids: list, metadatas: list = None):
+        metadatas = metadatas or [{} for _ in doc_ids]
+        self.meta_path.write_text("\n".join(json.dumps(m) for m in metadatas), encoding="utf-8")
+        self.store.build(embeddings, doc_ids)
+        self.metadatas = metadatas
+        return self
+
+    def build_streaming(self, batches):
+        self.store.build_streaming(batches)
+        self.metadatas = [{} for _ in self.store.doc_ids]
+        self.meta_path.write_text("\n".join(json.dumps(m) for m in self.metadatas), encoding="utf-8")
+        return self
+
+    def open(self):
+        self.store.open()
+        if self.meta_path.exists():
+            self.metadatas = [json.loads(l) for l in self.meta_path.read_text(encoding="utf-8").splitlines()]
+        else:
+            # Indexes written before metadata existed: ids only
+            self.metadatas = [{} for _ in self.store.doc_ids]
+        return self
+
+    @property
+    def doc_ids(self) -> list:
+        return self.store.doc_ids
+
+    def search(self, query_embedding, k: int, where: dict = None) -> list:
+        ids = self.store.doc_ids
+        fetch = min(len(ids), k * self.OVERSAMPLE if where else k)
+        if fetch == 0:
+            return []
+        distances, indices = self.store.search([query_embedding], fetch)
+        hits = []
+        for dist, idx in zip(distances[0], indices[0]):
+            if not 0 <= idx < len(ids):
+                continue
+            meta = self.metadatas[idx] if idx < len(self.metadatas) else {}
+            if where and not _matches(meta, where):
+                continue
+            hits.append((ids[idx], -float(dist), meta))
+            if len(hits) == k:
+                break
+        return hits
+
+    def memory_report(self) -> dict:
+        return {"backend": self.name, **self.store.memory_report()}
+
+
+class ChromaBackend(VectorBackend):
+    """Persistent ChromaDB collection; embeddings are supplied by the caller, never by Chroma."""
+    name = "chroma"
+    BATCH = 5000     # Chroma rejects very large single add() calls
+
+    def __init__(self, persist_dir: Path, collection: str = "kunit_reference_chunks", space: str = "l2"):
+        import chromadb
+        from chromadb.config import Settings
+        self.persist_dir = Path(persist_dir)
+        self.persist_dir.mkdir(parents=True, exist_ok=True)
+        self.client = chromadb.PersistentClient(path=str(self.persist_dir),
+                                                settings=Settings(anonymized_telemetry=False))
+        self.collection_name = collection
+        self.space = space
+        self.collection = None
+        self._ids = []
+
+    def _get(self, create: bool):
+        if create:
+            return self.client.get_or_create_collection(self.collection_name, metadata={"hnsw:space": self.space})
+        return self.client.get_collection(self.collection_name)
+
+    def exists(self) -> bool:
+        try:
+            return self._get(create=False).count() > 0
+        except Exception:
+            return False
+
+    def build(self, embeddings, doc_ids: list, metadatas: list = None):
+        try:
+            self.client.delete_collection(self.collection_name)
+        except Exception:
+            pass
+        self.collection = self._get(create=True)
+        vectors = [list(map(float, e)) for e in embeddings]
+        # Chroma rejects empty metadata dicts
+        metas = [m or {"id": d} for d, m in zip(doc_ids, metadatas or [None] * len(doc_ids))]
+        for start in range(0, len(doc_ids), self.BATCH):
+            end = start + self.BATCH
+            self.collection.add(ids=list(doc_ids[start:end]), embeddings=vectors[start:end], metadatas=metas[start:end])
+        self._ids = list(doc_ids)
+        print(f"✅ Wrote Chroma collection '{self.collection_name}' with {len(doc_ids)} vectors to {self.persist_dir}")
+        return self
+
+    def build_streaming(self, batches):
+        try:
+            self.client.delete_collection(self.collection_name)
+        except Exception:
+            pass
+        self.collection = self._get(create=True)
+        self._ids = []
+        for embeddings, doc_ids in batches:
+            vectors = [list(map(float, e)) for e in embeddings]
+            for start in range(0, len(doc_ids), self.BATCH):
+                end = start + self.BATCH
+                self.collection.add(ids=list(doc_ids[start:end]), embeddings=vectors[start:end],
+                                    metadatas=[{"id": d} for d in doc_ids[start:end]])
+            self._ids += list(doc_ids)
+        print(f"✅ Wrote Chroma collection '{self.collection_name}' with {len(self._ids)} vectors to {self.persist_dir}")
+        return self
+
+    def open(self):
+        self.collection = self._get(create=False)
+        self._ids = self.collection.get(include=[])["ids"]
+        return self
+
+    @property
+    def doc_ids(self) -> list:
+        return self._ids
+
+    def search(self, query_embedding, k: int, where: dict = None) -> list:
+        if not self._ids:
+            return []
+        result = self.collection.query(query_embeddings=[list(map(float, query_embedding))],
+                                       n_results=min(k, len(self._ids)), where=where or None,
+                                       include=["metadatas", "distances"])
+        return [(doc_id, -float(dist), meta or {})
+                for doc_id, dist, meta in zip(result["ids"][0], result["distances"][0], result["metadatas"][0])]
+
+    def memory_report(self) -> dict:
+        disk = sum(f.stat().st_size for f in self.persist_dir.rglob("*") if f.is_file())
+        return {"backend": self.name, "vectors": len(self._ids), "file_mb": disk / 2**20,
+                "process_rss_mb": round(resident_memory_mb(), 1)}
+
+
+VECTOR_BACKENDS = ("faiss", "chroma")
+
+
+def make_backend(name: str, base_dir: Path, **options) -> VectorBackend:
+    """Backend stored under base_dir with the generator's usual file names."""
+    base_dir = Path(base_dir)
+    base_dir.mkdir(parents=True, exist_ok=True)
+    if name == "faiss":
+        return FaissBackend(base_dir / "code_index.faiss", base_dir / "file_map.txt", **options)
+    if name == "chroma":
+        return ChromaBackend(base_dir / "chroma_db", **options)
+    raise ValueError(f"Unknown vector backend '{name}'. Use one of: {', '.join(VECTOR_BACKENDS)}.")
@@ -0,0 +1,187 @@
+import argparse
+import os
+import time
+from pathlib import Path
+import numpy as np
+import faiss
+
+
+def resident_memory_mb() -> float:
+    """Current process RSS, used to report what an opened index actually costs."""
+    try:
+        with open("/proc/self/status") as f:
+            for line in f:
+                if line.startswith("VmRSS:"):
+                    return int(line.split()[1]) / 1024.0
+    except OSError:
+        pass
+    return 0.0
+
+
+class QuantizedVectorStore:
+    """
+    On-disk FAISS index for kernel-scale corpora. Vectors are stored as IVF lists of
+    8-bit scalar-quantized ("sq8") or product-quantized ("pq") codes, and the index is
+    opened with IO_FLAG_MMAP so inverted lists are paged in lazily as probes touch them.
+    nprobe trades recall for latency. Corpora too small to train an IVF stay on IndexFlatL2.
+    """
+
+    MIN_TRAIN_PER_LIST = 39   # FAISS wants ~39 training points per centroid
+
+    def __init__(self, index_path: Path, map_path: Path, quantization: str = "sq8",
+                 nlist: int = None, pq_m: int = 16, nprobe: int = 8):
+        if quantization not in ("sq8", "pq", "flat"):
+            raise ValueError(f"Unknown quantization '{quantization}'. Use sq8, pq or flat.")
+        self.index_path = Path(index_path)
+        self.map_path = Path(map_path)
+        self.quantization = quantization
+        self.nlist = nlist
+        self.pq_m = pq_m
+        self.nprobe = nprobe
+        self.index = None
+        self.doc_ids = []
+
+    # ---------------- Build ----------------
+    def _choose_nlist(self, n: int) -> int:
+        if self.nlist:
+            return self.nlist
+        return max(1, min(int(4 * np.sqrt(n)), n // self.MIN_TRAIN_PER_LIST))
+
+    def _new_index(self, dim: int, n: int):
+        nlist = self._choose_nlist(n)
+        if self.quantization == "flat" or nlist < 2:
+            return faiss.IndexFlatL2(dim)
+        quantizer = faiss.IndexFlatL2(dim)
+        if self.quantization == "pq":
+            m = self.pq_m if dim % self.pq_m == 0 else 8
+            return faiss.IndexIVFPQ(quantizer, dim, nlist, m, 8)
+        return faiss.IndexIVFScalarQuantizer(quantizer, dim, nlist, faiss.ScalarQuantizer.QT_8bit, faiss.METRIC_L2)
+
+    def build(self, embeddings, doc_ids: list, batch_size: int = 65536, train_size: int = 100000):
+        """Train on a sample, add in batches, write index + doc id map, then reopen via mmap."""
+        embeddings = np.ascontiguousarray(embeddings, dtype="float32")
+        n, dim = embeddings.shape
+        index = self._new_index(dim, n)
+        if not index.is_trained:
+            sample = embeddings[np.random.default_rng(0).choice(n, min(n, train_size), replace=False)]
+            print(f"🧮 Training {type(index).__name__} on {len(sample)} vectors...")
+            index.train(sample)
+        for start in range(0, n, batch_size):
+            index.add(embeddings[start:start + batch_size])
+        faiss.write_index(index, str(self.index_path))
+        self.map_path.write_text("\n".join(str(d) for d in doc_ids))
+        print(f"✅ Wrote {type(index).__name__} with {n} vectors to {self.index_path}")
+        return self.open()
+
+    def build_streaming(self, batches, train_size: int = 100000):
+        """
+        Build from an iterable of (embeddings, doc_ids) batches without holding the whole corpus:
+        the first train_size vectors are buffered to train the IVF (nlist is chosen from that
+        sample), every later batch is added as it arrives.
+        """
+        index, pending, doc_ids = None, [], []
+        for embeddings, batch_ids in batches:
+            embeddings = np.ascontiguousarray(embeddings, dtype="float32")
+            doc_ids += [str(d) for d in batch_ids]
+            if index is not None:
+                index.add(embeddings)
+                continue
+            pending.append(embeddings)
+            if sum(len(p) for p in pending) >= train_size:
+                index = self._trained_index(np.vstack(pending))
+                pending = []
+        if index is None:
+            if not pending:
+                raise ValueError("No vectors to index.")
+            index = self._trained_index(np.vstack(pending))
+        faiss.write_index(index, str(self.index_path))
+        self.map_path.write_text("\n".join(doc_ids))
+        print(f"✅ Wrote {type(index).__name__} with {index.ntotal} vectors to {self.index_path}")
+        return self.open()
+
+    def _trained_index(self, sample):
+        """New index sized and trained on sample, with the sample already added."""
+        index = self._new_index(sample.shape[1], len(sample))
+        if not index.is_trained:
+            print(f"🧮 Training {type(index).__name__} on {len(sample)} vectors...")
+            index.train(sample)
+        index.add(sample)
+        return index
+
+    # ---------------- Query ----------------
+    def open(self):
+        before = resident_memory_mb()
+        try:
+            self.index = faiss.read_index(str(self.index_path), faiss.IO_FLAG_MMAP | faiss.IO_FLAG_READ_ONLY)
+        except RuntimeError:
+            # Flat indexes from older FAISS builds cannot be mmapped; load them normally.
+            self.index = faiss.read_index(str(self.index_path))
+        self.doc_ids = self.map_path.read_text().splitlines()
+        self.set_nprobe(self.nprobe)
+        self.open_cost_mb = resident_memory_mb() - before
+        return self
+
+    def set_nprobe(self, nprobe: int):
+        self.nprobe = nprobe
+        try:
+            faiss.extract_index_ivf(self.index).nprobe = nprobe
+        except RuntimeError:
+            pass    # flat index: nothing to tune
+
+    def search(self, query_embeddings, k: int):
+        query = np.ascontiguousarray(query_embeddings, dtype="float32")
+        return self.index.search(query, k)
+
+    def memory_report(self) -> dict:
+        ntotal = self.index.ntotal
+        try:
+            code_size = faiss.extract_index_ivf(self.index).code_size
+        except RuntimeError:
+            code_size = self.index.d * 4
+        return {
+            "index_type": type(self.index).__name__,
+            "vectors": ntotal,
+            "bytes_per_vector": code_size,
+            "file_mb": os.path.getsize(self.index_path) / 2**20,
+            "float32_equivalent_mb": ntotal * self.index.d * 4 / 2**20,
+            "open_rss_mb": round(self.open_cost_mb, 1),
+            "process_rss_mb": round(resident_memory_mb(), 1),
+        }
+
+
+def benchmark(store: QuantizedVectorStore, embeddings, queries: int = 200, k: int = 10,
+              nprobes=(1, 2, 4, 8, 16, 32, 64)):
+    """Recall@k of the quantized index against exact search, per nprobe, with latency."""
+    embeddings = np.ascontiguousarray(embeddings, dtype="float32")
+    rng = np.random.default_rng(1)
+    q = embeddings[rng.choice(len(embeddings), min(queries, len(embeddings)), replace=False)]
+    exact = faiss.IndexFlatL2(embeddings.shape[1])
+    exact.add(embeddings)
+    _, truth = exact.search(q, k)
+
+    print(f"{'nprobe':>8}{'recall@' + str(k):>12}{'ms/query':>12}")
+    for nprobe in nprobes:
+        store.set_nprobe(nprobe)
+        start = time.perf_counter()
+        _, found = store.search(q, k)
+        ms = 1000.0 * (time.perf_counter() - start) / len(q)
+        recall = np.mean([len(set(f) & set(t)) / k for f, t in zip(found, truth)])
+        print(f"{nprobe:>8}{recall:>12.3f}{ms:>12.3f}")
+    for key, value in store.memory_report().items():
+        print(f"{key:>22}: {value}")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Build a quantized, mmap-able index and report recall/latency/memory.")
+    parser.add_argument("embeddings", help=".npy file of float32 embeddings (one row per chunk)")
+    parser.add_argument("--out", default="code_index_sq8.faiss")
+    parser.add_argument("--quantization", default="sq8", choices=["sq8", "pq", "flat"])
+    parser.add_argument("--nlist", type=int, default=None)
+    parser.add_argument("--k", type=int, default=10)
+    args = parser.parse_args()
+
+    vectors = np.load(args.embeddings, mmap_mode="r")
+    store = QuantizedVectorStore(Path(args.out), Path(args.out).with_suffix(".map"),
+                                 quantization=args.quantization, nlist=args.nlist)
+    store.build(vectors, [str(i) for i in range(len(vectors))])
+    benchmark(store, vectors, k=args.k)
@@ -1,14 +1,14 @@
 
 import os
-import re
 from pathlib import Path
 from dotenv import load_dotenv
 
-import chromadb
-from chromadb.config import Settings
 from sentence_transformers import SentenceTransformer
 from openai import OpenAI
 
+from KunitGeneration.retrieval.dense_retriever import DenseRetriever, chunk_files, chunk_text
+from KunitGeneration.retrieval.vector_backends import make_backend
+
 
 class KUnitTestGenerator:
     """Generate KUnit tests using RAG + ChromaDB + LLM"""
@@ -19,6 +19,7 @@ class KUnitTestGenerator:
         model_name: str,
         temperature: float = 0.2,
         max_retries: int = 3,
+        vector_backend: str = "chroma",
     ):
         if not main_test_dir.is_dir():
             raise FileNotFoundError(main_test_dir)
@@ -28,11 +29,9 @@ class KUnitTestGenerator:
         self.reference_dir = self.base_dir / "reference_testcases"
         self.output_dir = self.base_dir / "generated_tests"
         self.logs_dir = self.base_dir / "compilation_log"
-        self.chroma_dir = self.base_dir / "chroma_db"
 
         self.output_dir.mkdir(exist_ok=True)
         self.logs_dir.mkdir(exist_ok=True)
-        self.chroma_dir.mkdir(exist_ok=True)
 
         # ---------------- LLM ----------------
         self.model_name = model_name
@@ -49,86 +48,32 @@ class KUnitTestGenerator:
         # ---------------- Embeddings ----------------
         self.embed_model = SentenceTransformer("all-MiniLM-L6-v2")
 
-        # ---------------- ChromaDB ----------------
-        self.chroma = chromadb.Client(
-            Settings(
-                persist_directory=str(self.chroma_dir),
-                anonymized_telemetry=False
-            )
-        )
-
-        self.collection = self.chroma.get_or_create_collection(
-            name="kunit_kernel_functions"
+        # ---------------- Vector store ----------------
+        # Same retriever and chunking as the main generator; only the backend differs
+        self.retriever = DenseRetriever(
+            make_backend(vector_backend, self.base_dir / "function_index"),
+            self.embed_model,
+            normalize=True
         )
 
-        if self.collection.count() == 0:
+        if not self.retriever.backend.exists():
             self._build_index()
+        else:
+            self.retriever.load_or_build([])
 
     # =====================================================================
-    # FUNCTION EXTRACTION (STRUCTURAL CHUNKING)
-    # =====================================================================
-
-    def _extract_functions(self, code: str):
-        pattern = re.compile(
-            r"(static\s+)?[\w\*\s]+\s+(\w+)\s*\([^)]*\)\s*\{",
-            re.MULTILINE
-        )
-
-        functions = []
-        matches = list(pattern.finditer(code))
-
-        for i, match in enumerate(matches):
-            start = match.start()
-            end = matches[i + 1].start() if i + 1 < len(matches) else len(code)
-            fn_body = code[start:end]
-
-            functions.append({
-                "name": match.group(2),
-                "code": fn_body.strip()
-            })
-
-        return functions
-
-    # =====================================================================
-    # BUILD CHROMADB INDEX (ONCE)
+    # BUILD INDEX (ONCE, FUNCTION-LEVEL CHUNKS)
     # =====================================================================
 
     def _build_index(self):
-        print("📦 Building ChromaDB index (function-level kernel code)...")
-
-        documents, metadatas, ids = [], [], []
-
-        for file in self.reference_dir.rglob("*.c"):
-            code = file.read_text(errors="ignore")
-            functions = self._extract_functions(code)
-
-            for idx, fn in enumerate(functions):
-                documents.append(fn["code"])
-                metadatas.append({
-                    "function": fn["name"],
-                    "file": str(file),
-                    "subsystem": file.parent.name
-                })
-                ids.append(f"{file.stem}_{fn['name']}_{idx}")
+        print("📦 Building index (function-level kernel code)...")
 
-        if not documents:
+        chunks = chunk_files(sorted(self.reference_dir.rglob("*.c")), granularity="function")
+        if not chunks:
             raise RuntimeError("No kernel functions found")
 
-        embeddings = self.embed_model.encode(
-            documents,
-            normalize_embeddings=True,
-            show_progress_bar=True
-        ).tolist()
-
-        self.collection.add(
-            documents=documents,
-            embeddings=embeddings,
-            metadatas=metadatas,
-            ids=ids
-        )
-
-        # Removed self.chroma.persist() → persistence is automatic now
-        print(f"✅ Indexed {len(documents)} kernel functions")
+        self.retriever.build(chunks)
+        print(f"✅ Indexed {len(chunks)} kernel functions")
 
     # =====================================================================
     # RETRIEVE CONTEXT
@@ -140,20 +85,12 @@ class KUnitTestGenerator:
         k: int = 5,
         subsystem: str | None = None
     ):
-        query_embedding = self.embed_model.encode(
-            query,
-            normalize_embeddings=True
-        ).tolist()
-
         where = {"subsystem": subsystem} if subsystem else None
+        hits = self.retriever.search(query, k, where=where)
 
-        results = self.collection.query(
-            query_embeddings=[query_embedding],
-            n_results=k,
-            where=where
-        )
-
-        return results["documents"][0], results["metadatas"][0]
+        docs = [chunk_text(doc_id, meta) for doc_id, _, meta in hits]
+        metas = [meta for _, _, meta in hits]
+        return docs, metas
 
     # =====================================================================
     # GENERATE KUNIT TEST (LLM)
@@ -0,0 +1,300 @@
+# kunit_daemon.py
+
+import argparse
+import contextlib
+import itertools
+import json
+import queue
+import sys
+import threading
+import time
+import traceback
+import urllib.error
+import urllib.request
+from dataclasses import dataclass, field, asdict
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from pathlib import Path
+from KunitGeneration.data_ingestion.function_extraction import CFunctionExtractor
+from KunitGeneration.data_ingestion.git_source import GitObjectReader
+from KunitGeneration.data_ingestion.incremental import plan_incremental
+
+
+@dataclass
+class Job:
+    id: str
+    spec: dict
+    status: str = "queued"          # queued, running, done, failed, cancelled
+    created: float = field(default_factory=time.time)
+    started: float = None
+    finished: float = None
+    result: dict = None
+    error: str = None
+    log_path: str = None
+
+    def summary(self) -> dict:
+        return {k: v for k, v in asdict(self).items() if k != "spec"} | {"source": self.spec.get("source")}
+
+
+class _JobOutput:
+    """
+    The service's stdout: everything goes to the console, and what the job threads print (the
+    worker and the generator's exec/speculative pools) is also copied into the running job's
+    log. Installed once; unlike redirect_stdout, HTTP handler threads never write into a job log.
+    """
+    JOB_THREADS = ("kunit-jobs", "kunit-exec", "speculative")
+
+    def __init__(self, console):
+        self.console = console
+        self.log = None
+
+    @contextlib.contextmanager
+    def capture(self, log):
+        self.log = log
+        try:
+            yield
+        finally:
+            self.log = None
+
+    def write(self, text):
+        self.console.write(text)
+        log = self.log
+        if log is not None and threading.current_thread().name.startswith(self.JOB_THREADS):
+            log.write(text)
+        return len(text)
+
+    def flush(self):
+        self.console.flush()
+        log = self.log
+        if log is not None:
+            log.flush()
+
+
+class GenerationService:
+    """
+    Keeps one KUnitTestGenerator warm (embedding model, vector/lexical indexes, API client,
+    kunit build trees) and runs submitted jobs on it one at a time: they share the kernel tree
+    and the generated_tests directory, so jobs are queued rather than run concurrently.
+
+    Job spec: {"source": driver path inside the kernel tree, "rev": optional commit to read it at,
+    "incremental_since": optional commit to diff against, "functions": optional list of names,
+    "makefile"/"kconfig"/"config": optional overrides}.
+    """
+
+    def __init__(self, generator):
+        self.generator = generator
+        self.jobs_dir = generator.base_dir / "jobs"
+        self.jobs = {}
+        self.queue = queue.Queue()
+        self.running = None
+        self.started = time.time()
+        self._ids = itertools.count(1)
+        self._lock = threading.Lock()
+        self.output = _JobOutput(sys.stdout)
+        sys.stdout = self.output
+        threading.Thread(target=self._worker, name="kunit-jobs", daemon=True).start()
+
+    # ---------------- Queue ----------------
+    def submit(self, spec: dict) -> Job:
+        if not spec.get("source"):
+            raise ValueError("job needs a 'source' driver path")
+        with self._lock:
+            job = Job(f"{time.strftime('%Y%m%d-%H%M%S')}-{next(self._ids)}", spec)
+            self.jobs[job.id] = job
+        self.queue.put(job.id)
+        return job
+
+    def cancel(self, job_id: str) -> bool:
+        """Only queued jobs can be cancelled; a running job owns the build tree until it ends."""
+        job = self.jobs.get(job_id)
+        if job is None or job.status != "queued":
+            return False
+        job.status = "cancelled"
+        return True
+
+    def health(self) -> dict:
+        queued = sum(1 for j in self.jobs.values() if j.status == "queued")
+        return {"status": "ok", "queued": queued, "running": self.running,
+                "uptime_s": round(time.time() - self.started, 1), "backend": self.generator.backend}
+
+    def _worker(self):
+        while True:
+            job = self.jobs[self.queue.get()]
+            if job.status == "cancelled":
+                continue
+            self.running = job.id
+            job.status, job.started = "running", time.time()
+            try:
+                job.result = self._run(job)
+                job.status = "done"
+            except Exception as e:
+                job.status, job.error = "failed", f"{e}\n{traceback.format_exc()}"
+            finally:
+                job.finished = time.time()
+                self.running = None
+
+    # ---------------- Job execution ----------------
+    def _run(self, job: Job) -> dict:
+        spec, gen = job.spec, self.generator
+        job_dir = self.jobs_dir / job.id
+        job_dir.mkdir(parents=True, exist_ok=True)
+        job.log_path = str(job_dir / "log.txt")
+        with open(job.log_path, "w", encoding="utf-8") as log, self.output.capture(log):
+            source_path = Path(spec["source"])
+            rel = source_path.relative_to(gen.kernel_dir).as_posix() if source_path.is_absolute() else spec["source"]
+            worktree_path = source_path = gen.kernel_dir / rel
+            if spec.get("rev"):
+                # The whole job, not just extraction, works on the driver as it is at rev
+                source_path = job_dir / "rev_source" / rel
+                source_path.parent.mkdir(parents=True, exist_ok=True)
+                with GitObjectReader(gen.kernel_dir, spec["rev"]) as reader:
+                    source_path.write_text(reader.read(rel), encoding="utf-8")
+            source_code = source_path.read_text(encoding="utf-8", errors="ignore")
+
+            functions_dir = job_dir / "test_functions"
+            CFunctionExtractor(source_code=source_code).process_and_save(str(functions_dir))
+
+            only = set(spec["functions"]) if spec.get("functions") else None
+            if spec.get("incremental_since"):
+                plan = plan_incremental(gen.kernel_dir, spec["incremental_since"], spec.get("rev") or "HEAD",
+                                        rel, gen.output_dir)
+                only = plan.queue if only is None else only & plan.queue
+                print(f"🔁 Incremental job: {len(only)} functions affected since {spec['incremental_since']}")
+
+            gen.retarget(source_path, functions_dir,
+                         makefile_path=spec.get("makefile") or worktree_path.parent / "Makefile",
+                         kconfig_path=spec.get("kconfig") or worktree_path.parent / "Kconfig",
+                         config_file=spec.get("config"))
+            passed = gen.run(only) or {}
+        totals = gen.ledger.totals()
+        return {"passed": sorted(passed), "tests": [str(p) for p in passed.values()],
+                "llm_calls": int(totals["llm_calls"]), "tokens": int(totals["tokens"]),
+                "build_seconds": round(totals["build_seconds"], 1)}
+
+
+def make_handler(service: GenerationService):
+    class Handler(BaseHTTPRequestHandler):
+        def log_message(self, *args):
+            pass
+
+        def _reply(self, code: int, payload):
+            body = json.dumps(payload, indent=2).encode()
+            self.send_response(code)
+            self.send_header("Content-Type", "application/json")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+        def _job(self):
+            parts = self.path.strip("/").split("/")
+            return service.jobs.get(parts[1]) if len(parts) == 2 and parts[0] == "jobs" else None
+
+        def do_GET(self):
+            if self.path == "/health":
+                return self._reply(200, service.health())
+            if self.path == "/jobs":
+                return self._reply(200, [j.summary() for j in service.jobs.values()])
+            job = self._job()
+            if job is None:
+                return self._reply(404, {"error": "not found"})
+            payload = asdict(job)
+            if job.log_path and Path(job.log_path).exists():
+                payload["log_tail"] = Path(job.log_path).read_text(encoding="utf-8").splitlines()[-40:]
+            return self._reply(200, payload)
+
+        def do_POST(self):
+            if self.path != "/jobs":
+                return self._reply(404, {"error": "not found"})
+            try:
+                spec = json.loads(self.rfile.read(int(self.headers.get("Content-Length", 0))) or b"{}")
+                job = service.submit(spec)
+            except (ValueError, json.JSONDecodeError) as e:
+                return self._reply(400, {"error": str(e)})
+            return self._reply(202, job.summary())
+
+        def do_DELETE(self):
+            job = self._job()
+            if job is None:
+                return self._reply(404, {"error": "not found"})
+            if not service.cancel(job.id):
+                return self._reply(409, {"error": f"job is {job.status}"})
+            return self._reply(200, job.summary())
+
+    return Handler
+
+
+def submit_job(url: str, spec: dict, wait: bool = False, poll: float = 2.0) -> dict:
+    """CI side: post a job and optionally wait for it to finish."""
+    req = urllib.request.Request(f"{url}/jobs", data=json.dumps(spec).encode(),
+                                 headers={"Content-Type": "application/json"}, method="POST")
+    with urllib.request.urlopen(req) as resp:
+        job = json.loads(resp.read())
+    print(f"📨 Submitted job {job['id']}")
+    while wait and job["status"] in ("queued", "running"):
+        time.sleep(poll)
+        with urllib.request.urlopen(f"{url}/jobs/{job['id']}") as resp:
+            job = json.loads(resp.read())
+    return job
+
+
+def serve(args):
+    from KunitGeneration.model_interface.llm_model import KUnitTestGenerator
+    start = time.perf_counter()
+    generator = KUnitTestGenerator(
+        main_test_dir=Path(args.base_dir),
+        model_name=args.model,
+        temperature=args.temperature,
+        kernel_dir=Path(args.kernel_dir),
+        backend=args.backend,
+        use_uml=args.uml,
+    )
+    service = GenerationService(generator)
+    server = ThreadingHTTPServer((args.host, args.port), make_handler(service))
+    print(f"🟢 Warm in {time.perf_counter() - start:.1f}s; serving on http://{args.host}:{args.port} "
+          f"(POST /jobs, GET /jobs[/<id>], DELETE /jobs/<id>, GET /health)")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.server_close()
+        generator.runner.drain()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Resident KUnit generation service and its client.")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("serve", help="load models and indexes once and accept jobs")
+    p.add_argument("--host", default="127.0.0.1")
+    p.add_argument("--port", type=int, default=8765)
+    p.add_argument("--base-dir", default="main_test_dir")
+    p.add_argument("--kernel-dir", default="/home/amd/linux")
+    p.add_argument("--model", default="qwen/qwen3-coder-480b-a35b-instruct")
+    p.add_argument("--temperature", type=float, default=0.4)
+    p.add_argument("--backend", default="nvidia", choices=["nvidia", "local"])
+    p.add_argument("--uml", action="store_true")
+
+    p = sub.add_parser("submit", help="queue a job on a running service")
+    p.add_argument("source", help="driver path, absolute or relative to the kernel tree")
+    p.add_argument("--url", default="http://127.0.0.1:8765")
+    p.add_argument("--rev", default=None)
+    p.add_argument("--incremental-since", default=None)
+    p.add_argument("--function", action="append", default=None, dest="functions")
+    p.add_argument("--wait", action="store_true")
+
+    args = parser.parse_args()
+    if args.command == "serve":
+        return serve(args)
+    spec = {k: v for k, v in (("source", args.source), ("rev", args.rev), ("functions", args.functions),
+                              ("incremental_since", args.incremental_since)) if v}
+    try:
+        job = submit_job(args.url, spec, wait=args.wait)
+    except urllib.error.URLError as e:
+        raise SystemExit(f"❌ No service at {args.url}: {e}")
+    print(json.dumps(job, indent=2))
+    if job["status"] == "failed":
+        raise SystemExit(1)
+
+
+if __name__ == "__main__":
+    main()
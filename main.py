@@ -4,6 +4,8 @@ import requests
 from pathlib import Path
 from KunitGeneration.model_interface.llm_model import KUnitTestGenerator
 from KunitGeneration.data_ingestion.function_extraction import CFunctionExtractor  # Or update import path if needed
+from KunitGeneration.data_ingestion.git_source import GitObjectReader
+from KunitGeneration.data_ingestion.incremental import plan_incremental
 
 def fetch_github_raw_file(url: str) -> str:
     """Download source code from a raw GitHub URL.
@@ -18,19 +20,41 @@ def fetch_github_raw_file(url: str) -> str:
         source_code=file.read()
     return source_code
 
+def export_source_at_rev(kernel_dir: Path, rev: str, file_path: str, out_dir: Path) -> Path:
+    """
+    Write a kernel source file as it is at rev, straight from the git objects (no checkout),
+    to out_dir/<commit>/<path>. The generator reads the driver from this copy, so slicing,
+    harnesses and stubs see the same version the functions were extracted from.
+    """
+    rel = Path(file_path).relative_to(kernel_dir).as_posix()
+    with GitObjectReader(kernel_dir, rev) as reader:
+        print(f"📌 Reading {rel} at {rev} ({reader.commit[:12]})")
+        path = out_dir / reader.commit[:12] / rel
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(reader.read(rel), encoding="utf-8")
+    return path
+
 def main():
     # --- Configuration ---
     github_raw_url = "https://raw.githubusercontent.com/torvalds/linux/master/drivers/pinctrl/pinctrl-amd.c"  # ✅ Replace with your own
     main_test_dir = Path("main_test_dir")
     extracted_dir = Path("test_functions")
+    kernel_dir = Path("/home/amd/linux")
+    kernel_rev = None  # e.g. "v6.10": read the driver from the kernel's git objects at this commit
+    incremental_since = None  # e.g. "v6.9": only regenerate functions changed since this commit
 
     model_name = "qwen/qwen3-coder-480b-a35b-instruct"  # Free model on OpenRouter
    
     temperature = 0.4
+    # Secondary providers to hedge slow NVIDIA requests to, as (provider, model) pairs
+    hedge_providers = [("openrouter", "qwen/qwen3-coder")]
     # --- Step 1: Fetch source code from GitHub ---
     try:
         file_path="/home/amd/linux/drivers/gpio/gpio-amdpt.c" #add requried file
-        source_code = fetch_github_raw_file(file_path)
+        source_path = Path(file_path)
+        if kernel_rev:
+            source_path = export_source_at_rev(kernel_dir, kernel_rev, file_path, main_test_dir / "rev_sources")
+        source_code = fetch_github_raw_file(str(source_path))
         #source_code = fetch_github_raw_file(github_raw_url) # use this to get from git hub
     except Exception as e:
         print(f"❌ Error fetching source code: {e}")
@@ -44,14 +68,39 @@ def main():
     except Exception as e:
         print(f"❌ Error during function extraction: {e}")
         return 
+
+    # --- Step 2b: Limit the run to functions affected since the last processed commit ---
+    only = None
+    if incremental_since:
+        try:
+            rel = Path(file_path).relative_to(kernel_dir).as_posix()
+            plan = plan_incremental(kernel_dir, incremental_since, kernel_rev or "HEAD", rel,
+                                    main_test_dir / "generated_tests")
+            only = plan.queue
+            print(f"🔁 {len(plan.changed)} changed, {len(plan.callers)} callers, "
+                  f"{len(plan.referenced)} referenced by existing tests -> {len(only)} queued")
+            if plan.removed:
+                print(f"⚠️ Removed upstream, their tests are stale: {', '.join(sorted(plan.removed))}")
+        except Exception as e:
+            print(f"❌ Error computing the incremental plan: {e}")
+            return
+        if not only:
+            print(f"✅ Nothing changed since {incremental_since} that affects {Path(file_path).name}; no tests to regenerate.")
+            return
     # --- Step 3: Generate KUnit tests ---
     try:
         generator = KUnitTestGenerator(
             main_test_dir=main_test_dir,
             model_name=model_name,
-            temperature=temperature
+            temperature=temperature,
+            hedge_providers=hedge_providers,
+            source_path=source_path,
+            amalgamate=False,  # True: merge passing tests into one suite per driver
+            speculative_k=1,  # >1: request K candidates per attempt, compile the best together
+            backend="nvidia",  # "local": OpenAI-compatible server on this machine (LOCAL_LLM_BASE_URL)
+            mock_mode="define"  # "static_stub": run-time KUnit stubs, one driver compile for all mock sets
         )
-        generator.run()
+        generator.run(only)
     except Exception as e:
         print(f"❌ Error during test generation: {e}")
 
@@ -1,45 +1,29 @@
 import re
+import sys
 from pathlib import Path
+from KunitGeneration.kernel_build.compile_autofix import parse_gcc_diagnostics, format_diagnostics, is_diagnostic_line
 
-def _compile_and_check(url: str) -> bool:
-    """Extract unique compiler errors with the offending code line (like GCC style)."""
+def _compile_and_check(url: str, test_file: str = None) -> bool:
+    """Extract unique compiler errors with the offending line of test_file (like GCC style)."""
     error_log_file = Path(url)
     if not error_log_file.exists():
         print(f"❌ Log file not found: {url}")
         return False
 
-    log_lines = error_log_file.read_text(encoding="utf-8").splitlines()
+    log_text = error_log_file.read_text(encoding="utf-8", errors="ignore")
 
+    # Compiler errors (JSON or text diagnostics) with the test line they point at
+    error_blocks = format_diagnostics(parse_gcc_diagnostics(log_text), test_file)
+
+    # Remaining error lines, e.g. from the linker or modpost
     seen = set()
-    error_blocks = []
-    i = 0
-    while i < len(log_lines):
-        line = log_lines[i]
-        # Match lines containing 'error:' or 'fatal error:'
-        if re.search(r"(error:|fatal error:)", line, re.IGNORECASE):
-            # Remove file path and line numbers
-            parts = line.split(':')
-            for j, p in enumerate(parts):
-                if 'error' in p.lower():
-                    clean_error = ':'.join(parts[j:]).strip()
-                    break
-            else:
-                clean_error = line.strip()
-
-            # Skip duplicates
-            if clean_error not in seen:
-                seen.add(clean_error)
-                # Attempt to get the next code line if it exists and looks like code (has indentation)
-                code_line = ""
-                if i + 1 < len(log_lines):
-                    next_line = log_lines[i + 1]
-                    if re.match(r"\s+\S", next_line):
-                        code_line = next_line.rstrip()
-                if code_line:
-                    error_blocks.append(f"{clean_error}\n{code_line}")
-                else:
-                    error_blocks.append(clean_error)
-        i += 1
+    for line in log_text.splitlines():
+        if is_diagnostic_line(line) or not re.search(r"(error:|fatal error:)", line, re.IGNORECASE):
+            continue
+        clean_error = line.strip()
+        if clean_error not in seen:
+            seen.add(clean_error)
+            error_blocks.append(clean_error)
 
     extracted_errors = "\n\n".join(error_blocks) if error_blocks else "No explicit error lines found."
 
@@ -56,5 +40,5 @@ def _compile_and_check(url: str) -> bool:
 
 
 if __name__ == "__main__":
-    url = "kunit_test.txt"
-    _compile_and_check(url)
+    url = sys.argv[1] if len(sys.argv) > 1 else "kunit_test.txt"
+    _compile_and_check(url, sys.argv[2] if len(sys.argv) > 2 else None)
@@ -1,10 +1,12 @@
 from pathlib import Path
+from KunitGeneration.kernel_build.kconfig_closure import config_for_object
 
 # Paths (adjust to your tree)
 GENERATED_TEST_DIR = Path("/home/amd/nithin/KunitGen/main_test_dir/generated_tests")
 MAKEFILE_PATH = Path("/home/amd/linux/drivers/pinctrl/Makefile")
 KCONFIG_PATH = Path("/home/amd/linux/drivers/pinctrl/Kconfig")
 CONFIG_FILE_PATH = Path("/home/amd/linux/my_pinctrl.config")
+DRIVER_OBJECT = "pinctrl-amd.o"
 
 def get_generated_tests():
     return [f.stem for f in GENERATED_TEST_DIR.glob("*.c")]
@@ -13,9 +15,11 @@ def fmt_config(test: str) -> str:
     return "CONFIG_" + test.upper()
 
 def infer_parent_feature(test: str) -> str:
-    # You may refine this logic based on your kernel tree
-    if "amd" in test.lower():
-        return "PINCTRL_AMD"
+    # The option that builds the driver under test, read from the Makefile
+    if MAKEFILE_PATH.exists():
+        driver = config_for_object(MAKEFILE_PATH, DRIVER_OBJECT)
+        if driver:
+            return driver
     return "PINCTRL"
 
 def add_makefile(tests):